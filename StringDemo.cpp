@@ -5,6 +5,13 @@
 #include <iostream>
 #include <algorithm>
 #include "string.h"
+#include "string_parallel.h"
+#include "string_distance.h"
+#include "string_escape.h"
+#include "string_cache.h"
+#include "string_blob.h"
+#include "string_glob.h"
+#include "string_dictionary.h"
 
 void print(int id, string::size_type n, string const& s)
 {
@@ -252,6 +259,134 @@ int main()
     // find a single character
     n = sFind.find("a");
     print(3, n, sFind);
+
+    // parallel_find_all / parallel_count / parallel_replace_all split the
+    // string across threads; short strings like this one stay on one thread
+    string sPar("one two one two one");
+    std::cout << "\"one\" found " << parallel_count(sPar, string("one")) << " times @";
+    for (auto pos : parallel_find_all(sPar, string("one")))
+        std::cout << ' ' << pos;
+    std::cout << '\n';
+    parallel_replace_all(sPar, string("one"), string("1"));
+    std::cout << sPar.c_str() << '\n'; // "1 two 1 two 1"
+
+    // Three chunks of an odd size: the match at min_chunk runs into the
+    // second chunk, which must then be entered one character late
+    string sBig(3 * string_parallel::min_chunk + 3, 'a');
+    std::vector<string::size_type> bigFound;
+    for (auto pos = sBig.find("aa"); pos != string::npos; pos = sBig.find("aa", pos + 2))
+        bigFound.push_back(pos);
+    assert(parallel_find_all(sBig, string("aa"), 4) == bigFound);
+    assert(parallel_count(sBig, string("aa"), 4) == bigFound.size());
+    parallel_replace_all(sBig, string("aa"), string("b"), 4);
+    assert(sBig.size() == bigFound.size() + 1 && sBig[sBig.size() - 1] == 'a');
+
+    // A long needle over blank padding wider than a chunk: every offset
+    // into a chunk is a match here, and the survey still has to be linear
+    string sPad(2 * string_parallel::min_chunk + 1000, ' ');
+    const string padNeedle(1000, ' ');
+    size_t padCount = 0;
+    for (auto pos = sPad.find(padNeedle); pos != string::npos; pos = sPad.find(padNeedle, pos + padNeedle.size()))
+        padCount++;
+    assert(parallel_count(sPad, padNeedle, 4) == padCount);
+    assert(parallel_find_all(sPad, padNeedle, 4).size() == padCount);
+    std::cout << bigFound.size() << " matches across chunks\n"; // 393217
+
+    string sAll("<a href=\"x\">Tom & Jerry</a>");
+    sAll.replace_all({ { "&", "&amp;" }, { "<", "&lt;" }, { ">", "&gt;" }, { "\"", "&quot;" } });
+    std::cout << sAll.c_str() << '\n'; // "&lt;a href=&quot;x&quot;&gt;Tom &amp; Jerry&lt;/a&gt;"
+    sAll.replace_all("&amp;", "and");
+    std::cout << sAll.c_str() << '\n'; // "&lt;a href=&quot;x&quot;&gt;Tom and Jerry&lt;/a&gt;"
+
+    // fixed_stringT is fully constexpr; a fixed_matcher precomputes its
+    // skip table at compile time
+    constexpr fixed_stringT method("GET");
+    constexpr auto request = method + " /index.html HTTP/1.1";
+    static_assert(request.size() == 24 && request.find(fixed_matcher(method)) == 0, "");
+    static constexpr fixed_matcher http(fixed_stringT("HTTP/"));
+    string sReq(request.c_str());
+    std::cout << "HTTP/ found @ " << sReq.find(http) << '\n'; // 16
+    static constexpr fixed_matcher slash(fixed_stringT("/"));
+    std::cout << "/ found @ " << sReq.find(slash) << '\n'; // 4
+#if __cpp_nontype_template_args >= 201911L
+    std::cout << "1 found @ " << sReq.find<"1">() << '\n'; // 21
+#endif
+
+    string kitten("kitten"), sitting("sitting");
+    std::cout << "levenshtein = " << levenshtein(kitten, sitting)                 // 3
+        << ", within 2: " << (levenshtein_bounded(kitten, sitting, 2) <= 2)     // 0
+        << ", damerau(ca, ac) = " << damerau_levenshtein(string("ca"), string("ac")) // 1
+        << ", lcs = " << lcs_length(kitten, sitting) << '\n';                  // 4
+    string names[] = { "kitten", "mitten", "sitting", "smitten" };
+    size_t scores[4];
+    levenshtein_batch(kitten, std::begin(names), std::end(names), scores);
+    for (size_t d : scores)
+        std::cout << d << ' '; // 0 1 3 2
+    std::cout << '\n';
+
+    string json("{\"name\":\"");
+    append_json_escaped(json, string("say \"hi\"\n"));
+    json.push_back('"');
+    std::cout << json.c_str() << '\n'; // {"name":"say \"hi\"\n"
+    string csv;
+    append_csv_quoted(csv, string("a,\"b\""));
+    std::cout << csv.c_str() << '\n'; // "a,""b"""
+    string b64, hex;
+    append_base64(b64, string("hello"));
+    append_hex(hex, string("hello"));
+    std::cout << b64.c_str() << ' ' << hex.c_str() << '\n'; // aGVsbG8= 68656c6c6f
+
+    // cached_string keeps freed buffers in per-thread free lists
+    for (int i = 0; i < 100; i++) {
+        cached_string tmp("short-lived");
+    }
+    string_cache::stats cacheStats = string_cache::thread_stats();
+    std::cout << "cache hits " << cacheStats.hits << ", misses " << cacheStats.misses << '\n'; // 99, 1
+
+    // adopt/release move a heap buffer in and out without copying
+    std::allocator<char> bufAlloc;
+    char* buf = bufAlloc.allocate(32);
+    memcpy(buf, "received payload", 16);
+    string sAdopt;
+    sAdopt.adopt<std::allocator<char>>(buf, 16, 32);
+    std::cout << sAdopt.c_str() << ", capacity " << sAdopt.capacity() << '\n'; // received payload, capacity 32
+    string::buffer released = sAdopt.release();
+    bufAlloc.deallocate(released.data, released.capacity);
+
+    // serialize_strings writes one blob; string_blob_view reads it in place
+    string words[] = { "alpha", "beta", "gamma" };
+    string blob = serialize_strings(std::begin(words), std::end(words));
+    string_blob_view<> blobView;
+    if (blobView.open(blob.data(), blob.size()))
+        std::cout << blobView.size() << " strings, [1] = " << blobView.c_str(1) << '\n'; // 3 strings, [1] = beta
+    string_arena arena;
+    auto loaded = blobView.materialize(arena);
+    std::cout << loaded[2].c_str() << '\n'; // gamma
+
+    // glob_pattern compiles a wildcard pattern once; glob_set checks many
+    glob_pattern logs("/var/log/*.[lt]og");
+    std::cout << logs.match(string("/var/log/app.log")) << logs.match(string("/var/log/app.txt")) << '\n'; // 10
+    glob_set routes;
+    routes.add("api.*.latency");
+    routes.add("api.users.*");
+    routes.add("*.errors");
+    routes.build();
+    std::vector<size_t> matched;
+    routes.match_all(string("api.users.latency"), matched);
+    for (size_t r : matched)
+        std::cout << r << ' '; // 0 1
+    std::cout << '\n';
+
+    // string_dictionary front codes sorted keys in blocks
+    string paths[] = { "/usr/bin/env", "/usr/bin/git", "/usr/lib/libc.so", "/usr/local/bin/cmake" };
+    string_dictionary dict(std::begin(paths), std::end(paths), 2);
+    string key;
+    dict.extract(2, key);
+    std::cout << dict.lookup(string("/usr/bin/git")) << ' ' << key.c_str() << '\n'; // 1 /usr/lib/libc.so
+    auto binRange = dict.prefix_range(string("/usr/bin/"));
+    std::cout << "/usr/bin/ ids [" << binRange.first << ", " << binRange.second << ")\n"; // [0, 2)
+    for (const string& k : dict)
+        std::cout << k.c_str() << '\n';
 }
 
 // Run program: Ctrl + F5 or Debug > Start Without Debugging menu
@@ -0,0 +1,210 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <utility>
+
+// A string whose length is part of its type. Everything here is constexpr
+// and fixed_stringT is a literal type, so it can be built, concatenated and
+// compared at compile time and (C++20) passed as a template parameter:
+//
+//   constexpr fixed_stringT get("GET");
+//   constexpr auto line = get + " / HTTP/1.1";
+//   static_assert(line.size() == 14 && line.find(fixed_matcher(get)) == 0);
+//
+// The characters are public so the type stays structural; don't write to
+// them directly.
+template<size_t N, typename CharT = char>
+struct fixed_stringT {
+    typedef CharT value_type;
+    typedef const value_type& const_reference;
+    typedef const value_type* const_pointer;
+    typedef const value_type* const_iterator;
+    typedef size_t size_type;
+
+    static constexpr size_type npos = size_type(-1);
+
+    // N characters plus '\0'
+    value_type m_data[N + 1] = {};
+
+    constexpr fixed_stringT() = default;
+
+    constexpr fixed_stringT(const value_type (&s)[N + 1]) {
+        for (size_type i = 0; i < N; i++) {
+            m_data[i] = s[i];
+        }
+    }
+
+    constexpr const_pointer c_str() const noexcept {
+        return m_data;
+    }
+
+    constexpr const_pointer data() const noexcept {
+        return m_data;
+    }
+
+    constexpr const_reference operator[](size_type x) const {
+        return m_data[x];
+    }
+
+    constexpr const_iterator begin() const noexcept {
+        return m_data;
+    }
+
+    constexpr const_iterator end() const noexcept {
+        return m_data + N;
+    }
+
+    static constexpr size_type size() noexcept {
+        return N;
+    }
+
+    static constexpr size_type length() noexcept {
+        return N;
+    }
+
+    static constexpr bool empty() noexcept {
+        return N == 0;
+    }
+
+    // Orders like stringT::compare: char_traits compares char as unsigned
+    template<size_t M>
+    constexpr int compare(const fixed_stringT<M, CharT>& str) const noexcept {
+        for (size_type i = 0; i < N && i < M; i++) {
+            if (m_data[i] != str.m_data[i]) {
+                return std::char_traits<CharT>::lt(m_data[i], str.m_data[i]) ? -1 : 1;
+            }
+        }
+        return N == M ? 0 : (N < M ? -1 : 1);
+    }
+
+    template<typename Matcher>
+    constexpr size_type find(const Matcher& m, size_type pos = 0) const noexcept {
+        return m.find(m_data, N, pos);
+    }
+
+    constexpr size_type find(value_type c, size_type pos = 0) const noexcept {
+        for (size_type i = pos; i < N; i++) {
+            if (m_data[i] == c) return i;
+        }
+        return npos;
+    }
+};
+
+template<typename CharT, size_t N>
+fixed_stringT(const CharT (&)[N]) -> fixed_stringT<N - 1, CharT>;
+
+template<size_t N, size_t M, typename CharT>
+constexpr fixed_stringT<N + M, CharT> operator+(const fixed_stringT<N, CharT>& lhs, const fixed_stringT<M, CharT>& rhs) {
+    fixed_stringT<N + M, CharT> result;
+    for (size_t i = 0; i < N; i++) {
+        result.m_data[i] = lhs.m_data[i];
+    }
+    for (size_t i = 0; i < M; i++) {
+        result.m_data[N + i] = rhs.m_data[i];
+    }
+    return result;
+}
+
+template<size_t N, size_t M, typename CharT>
+constexpr fixed_stringT<N + M - 1, CharT> operator+(const fixed_stringT<N, CharT>& lhs, const CharT (&rhs)[M]) {
+    return lhs + fixed_stringT<M - 1, CharT>(rhs);
+}
+
+template<size_t N, size_t M, typename CharT>
+constexpr fixed_stringT<N + M - 1, CharT> operator+(const CharT (&lhs)[N], const fixed_stringT<M, CharT>& rhs) {
+    return fixed_stringT<N - 1, CharT>(lhs) + rhs;
+}
+
+template<size_t N, size_t M, typename CharT>
+constexpr bool operator==(const fixed_stringT<N, CharT>& lhs, const fixed_stringT<M, CharT>& rhs) noexcept {
+    return lhs.compare(rhs) == 0;
+}
+
+template<size_t N, size_t M, typename CharT>
+constexpr bool operator!=(const fixed_stringT<N, CharT>& lhs, const fixed_stringT<M, CharT>& rhs) noexcept {
+    return lhs.compare(rhs) != 0;
+}
+
+template<size_t N, size_t M, typename CharT>
+constexpr bool operator<(const fixed_stringT<N, CharT>& lhs, const fixed_stringT<M, CharT>& rhs) noexcept {
+    return lhs.compare(rhs) < 0;
+}
+
+template<size_t N, size_t M, typename CharT>
+constexpr bool operator>(const fixed_stringT<N, CharT>& lhs, const fixed_stringT<M, CharT>& rhs) noexcept {
+    return lhs.compare(rhs) > 0;
+}
+
+template<size_t N, size_t M, typename CharT>
+constexpr bool operator<=(const fixed_stringT<N, CharT>& lhs, const fixed_stringT<M, CharT>& rhs) noexcept {
+    return lhs.compare(rhs) <= 0;
+}
+
+template<size_t N, size_t M, typename CharT>
+constexpr bool operator>=(const fixed_stringT<N, CharT>& lhs, const fixed_stringT<M, CharT>& rhs) noexcept {
+    return lhs.compare(rhs) >= 0;
+}
+
+// Searcher for a needle known at compile time. The Horspool skip table is
+// built when the matcher is constructed, so a constexpr matcher (or
+// stringT::find<"needle">() in C++20) pays nothing for it at run time, and
+// the candidate compare is unrolled over the needle's length.
+template<size_t N, typename CharT = char>
+class fixed_matcher {
+public:
+    typedef size_t size_type;
+    static constexpr size_type npos = size_type(-1);
+
+    constexpr fixed_matcher(const fixed_stringT<N, CharT>& needle) : m_needle(needle) {
+        // Characters are bucketed by their low byte. A shared bucket keeps
+        // the smallest shift, which is always safe.
+        for (size_type i = 0; i < 256; i++) {
+            m_skip[i] = N;
+        }
+        for (size_type i = 0; N > 0 && i < N - 1; i++) {
+            m_skip[_bucket(needle.m_data[i])] = N - 1 - i;
+        }
+    }
+
+    constexpr const fixed_stringT<N, CharT>& needle() const noexcept {
+        return m_needle;
+    }
+
+    // Position of the needle in [pos, len) of str, or npos
+    constexpr size_type find(const CharT* str, size_type len, size_type pos = 0) const noexcept {
+        if (pos > len || len - pos < N) return npos;
+        if (N == 0) return pos;
+
+        const CharT last = m_needle.m_data[N - 1];
+        for (size_type i = pos; i + N <= len; i += m_skip[_bucket(str[i + N - 1])]) {
+            if (str[i + N - 1] == last && _equal(str + i, std::make_index_sequence<N - (N > 0)>())) {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+private:
+    fixed_stringT<N, CharT> m_needle;
+    size_type m_skip[256] = {};
+
+    static constexpr size_type _bucket(CharT c) noexcept {
+        return static_cast<unsigned char>(c);
+    }
+
+    // Compares all but the last character, which the caller checked; a
+    // one character needle leaves nothing to compare
+    template<size_t... I>
+    constexpr bool _equal([[maybe_unused]] const CharT* p, std::index_sequence<I...>) const noexcept {
+        return ((p[I] == m_needle.m_data[I]) && ...);
+    }
+};
+
+template<size_t N, typename CharT>
+fixed_matcher(const fixed_stringT<N, CharT>&) -> fixed_matcher<N, CharT>;
+
+#if __cpp_nontype_template_args >= 201911L
+// One matcher per needle, built at compile time
+template<fixed_stringT Needle>
+inline constexpr fixed_matcher<Needle.size(), typename decltype(Needle)::value_type> fixed_matcher_v(Needle);
+#endif
@@ -1,7 +1,13 @@
 #pragma once
 #include <cassert>
+#include <cstring>
 #include <memory>
 #include <iterator>
+#include <string>
+#include <type_traits>
+#include <initializer_list>
+#include <utility>
+#include "fixed_string.h"
 
 //template<class CharT = char> class char_traits;
 
@@ -104,7 +110,7 @@ public:
 private:
     // not including '\0'
     size_type m_size = 0;
-    pointer m_ptr;
+    pointer m_ptr = nullptr;
     allocator_type m_allocator;
     size_type m_allocated = 0;
 
@@ -143,6 +149,39 @@ private:
         alloc(newSize + 1);
     }
 
+    // True if [p, p + count) lies in this string's buffer
+    constexpr bool _aliases(const_pointer p, size_type count) const noexcept {
+        return count > 0 && m_ptr != nullptr && p >= m_ptr && p < m_ptr + m_allocated;
+    }
+
+    // Splits the string into unmatched runs, reported as onText(pos, len),
+    // and key matches, reported as onMatch(pos, mapping).
+    template<typename Mappings, typename OnText, typename OnMatch>
+    constexpr void _for_each_mapping(const Mappings& mappings, const bool (&first)[256], OnText onText, OnMatch onMatch) const {
+        size_type r = 0, i = 0;
+        while (i < m_size) {
+            if (!first[static_cast<unsigned char>(m_ptr[i])]) {
+                i++;
+                continue;
+            }
+            const std::pair<stringT, stringT>* match = nullptr;
+            for (const auto& m : mappings) {
+                if (!m.first.empty() && i + m.first.m_size <= m_size && memcmp(m_ptr + i, m.first.data(), m.first.m_size) == 0) {
+                    match = &m;
+                    break;
+                }
+            }
+            if (match == nullptr) {
+                i++;
+                continue;
+            }
+            if (i > r) onText(r, i - r);
+            onMatch(i, *match);
+            r = i += match->first.m_size;
+        }
+        if (m_size > r) onText(r, m_size - r);
+    }
+
     constexpr inline int _compare(const_pointer a, size_type alen, const_pointer b, size_type blen) const noexcept {
         const size_type count = std::min(alen, blen);
         int res = memcmp(a, b, count);
@@ -171,6 +210,10 @@ public:
     }
 
     constexpr stringT(const stringT& str, size_type pos = 0) {
+        // Nothing to copy from a string that never allocated
+        if (str.m_ptr == nullptr) {
+            return;
+        }
         m_size = str.m_size - pos;
         alloc(m_size);
         memcpy(m_ptr, str.m_ptr + pos, m_size + 1);
@@ -218,6 +261,10 @@ public:
         if (&str == this) {
             return *this;
         }
+        if (str.m_ptr == nullptr) {
+            clear();
+            return *this;
+        }
         // TODO:Need to spend more time here
         //      should be enough for now
         m_size = str.size();
@@ -303,7 +350,7 @@ public:
 
     constexpr void clear() {
         m_size = 0;
-        *m_ptr = '\0';
+        if (m_ptr) *m_ptr = '\0';
     }
 
     constexpr stringT& assign(const stringT& str, size_type pos = 0, size_type count = npos) {
@@ -340,6 +387,52 @@ public:
         return m_allocator;
     }
 
+    // Heap buffer handed over by release(). It must be returned with
+    // allocator_type::deallocate(data, capacity).
+    struct buffer {
+        pointer data;
+        size_type size;
+        size_type capacity;
+    };
+
+    // Takes ownership of ptr without copying. ptr must come from
+    // allocate(capacity) on an allocator equal to this string's, and
+    // capacity must leave room for the '\0' written at ptr[size].
+    // SourceAllocator names the allocator the buffer came from, so a
+    // mismatch is caught at compile time:
+    //   s.adopt<std::allocator<char>>(p, n, cap);
+    template<typename SourceAllocator = allocator_type>
+    constexpr stringT& adopt(pointer ptr, size_type size, size_type capacity) {
+        static_assert(std::is_same<typename std::allocator_traits<SourceAllocator>::template rebind_alloc<value_type>, allocator_type>::value,
+            "the buffer must come from this string's allocator type");
+        static_assert(std::allocator_traits<allocator_type>::is_always_equal::value,
+            "stateful allocators must pass the allocator instance the buffer came from");
+        return adopt(ptr, size, capacity, allocator_type());
+    }
+
+    constexpr stringT& adopt(pointer ptr, size_type size, size_type capacity, const allocator_type& allocator) {
+        assert(ptr != nullptr && size < capacity);
+        if (m_ptr != nullptr) {
+            m_allocator.deallocate(m_ptr, m_allocated);
+        }
+        m_allocator = allocator;
+        m_ptr = ptr;
+        m_size = size;
+        m_allocated = capacity;
+        m_ptr[m_size] = '\0';
+        return *this;
+    }
+
+    // Gives up the heap buffer without copying and leaves the string
+    // empty. The caller owns the returned buffer.
+    constexpr buffer release() noexcept {
+        buffer b = { m_ptr, m_size, m_allocated };
+        m_ptr = nullptr;
+        m_size = 0;
+        m_allocated = 0;
+        return b;
+    }
+
     constexpr const_pointer data() const noexcept {
         return m_ptr;
     }
@@ -403,9 +496,45 @@ public:
             pointer old = m_ptr;
             size_t oldSize = capacity();
             pointer newPtr = m_allocator.allocate(newSize + 1);
-            memcpy(newPtr, old, m_size + 1);
+            if (old != nullptr) {
+                memcpy(newPtr, old, m_size + 1);
+            }
+            else {
+                newPtr[0] = '\0';
+            }
             m_ptr = newPtr;
             free(old, oldSize);
+            // free() clears the capacity, the new buffer's size has to be
+            // kept so it is returned to the allocator with the same size
+            m_allocated = newSize + 1;
+        }
+    }
+
+    // Resizes to at most count characters and lets op write them directly
+    // into the buffer, like std::basic_string::resize_and_overwrite.
+    // op(data(), count) returns the final size. The current contents are
+    // kept. A fresh buffer is sized exactly so large results don't pay for
+    // the usual 2x growth; a growing one doubles so repeated appends stay
+    // amortized O(1). The old buffer is only freed once op returns, so op
+    // may still read from it, e.g. when appending a string to itself.
+    template<typename Operation>
+    constexpr void resize_and_overwrite(size_type count, Operation op) {
+        pointer old = nullptr;
+        size_type oldAllocated = 0;
+        if (count >= m_allocated) {
+            old = m_ptr;
+            oldAllocated = m_allocated;
+            m_allocated = std::max(count + 1, 2 * m_allocated);
+            m_ptr = m_allocator.allocate(m_allocated);
+            if (old != nullptr) {
+                memcpy(m_ptr, old, std::min(m_size, count));
+            }
+        }
+        m_size = static_cast<size_type>(op(m_ptr, count));
+        assert(m_size <= count);
+        m_ptr[m_size] = '\0';
+        if (old != nullptr) {
+            m_allocator.deallocate(old, oldAllocated);
         }
     }
 
@@ -454,6 +583,106 @@ public:
         return (*this);
     }
 
+    // Replaces every non-overlapping occurrence of from with to, left to
+    // right. Unlike calling replace() per match this is linear: the matches
+    // are counted first, then the result is written in one pass, in place
+    // when it doesn't grow and into a single new buffer otherwise.
+    constexpr stringT& replace_all(const stringT& from, const stringT& to) {
+        return replace_all(from.data(), from.m_size, to.data(), to.m_size);
+    }
+
+    constexpr stringT& replace_all(const_pointer from, size_type fromCount, const_pointer to, size_type toCount) {
+        if (fromCount == 0 || fromCount > m_size) {
+            return *this;
+        }
+        if (_aliases(from, fromCount) || _aliases(to, toCount)) {
+            return replace_all(stringT(from, fromCount), stringT(to, toCount));
+        }
+
+        if (toCount <= fromCount) {
+            // The write position never passes the read position
+            size_type r = 0, w = 0;
+            for (size_type p = find_in(m_ptr, m_size, from, 0, fromCount); p != npos;
+                p = find_in(m_ptr, m_size, from, r, fromCount)) {
+                memmove(m_ptr + w, m_ptr + r, p - r);
+                w += p - r;
+                memcpy(m_ptr + w, to, toCount);
+                w += toCount;
+                r = p + fromCount;
+            }
+            memmove(m_ptr + w, m_ptr + r, m_size - r);
+            m_ptr[m_size = w + m_size - r] = '\0';
+            return *this;
+        }
+
+        size_type hits = 0;
+        for (size_type p = find_in(m_ptr, m_size, from, 0, fromCount); p != npos;
+            p = find_in(m_ptr, m_size, from, p + fromCount, fromCount)) {
+            hits++;
+        }
+        if (hits == 0) {
+            return *this;
+        }
+
+        stringT result;
+        result.resize_and_overwrite(m_size + hits * (toCount - fromCount), [&](pointer out, size_type newSize) {
+            size_type r = 0;
+            for (size_type p = find_in(m_ptr, m_size, from, 0, fromCount); p != npos;
+                p = find_in(m_ptr, m_size, from, r, fromCount)) {
+                memcpy(out, m_ptr + r, p - r);
+                out += p - r;
+                memcpy(out, to, toCount);
+                out += toCount;
+                r = p + fromCount;
+            }
+            memcpy(out, m_ptr + r, m_size - r);
+            return newSize;
+        });
+        swap(result);
+        return *this;
+    }
+
+    // Applies several replacements in one scan. At every position the
+    // first mapping whose key matches there wins, e.g.
+    //   s.replace_all({ { "&", "&amp;" }, { "<", "&lt;" }, { ">", "&gt;" } });
+    constexpr stringT& replace_all(std::initializer_list<std::pair<stringT, stringT>> mappings) {
+        // Characters a key can start with, to skip over plain text quickly
+        bool first[256] = {};
+        bool shrinks = true;
+        for (const auto& m : mappings) {
+            if (m.first.empty()) continue;
+            first[static_cast<unsigned char>(m.first[0])] = true;
+            shrinks = shrinks && m.second.m_size <= m.first.m_size;
+        }
+
+        size_type newSize = 0, hits = 0;
+        _for_each_mapping(mappings, first,
+            [&](size_type, size_type len) { newSize += len; },
+            [&](size_type, const std::pair<stringT, stringT>& m) { newSize += m.second.m_size; hits++; });
+        if (hits == 0) {
+            return *this;
+        }
+
+        if (shrinks) {
+            size_type w = 0;
+            _for_each_mapping(mappings, first,
+                [&](size_type r, size_type len) { memmove(m_ptr + w, m_ptr + r, len); w += len; },
+                [&](size_type, const std::pair<stringT, stringT>& m) { memcpy(m_ptr + w, m.second.data(), m.second.m_size); w += m.second.m_size; });
+            m_ptr[m_size = w] = '\0';
+            return *this;
+        }
+
+        stringT result;
+        result.resize_and_overwrite(newSize, [&](pointer out, size_type count) {
+            _for_each_mapping(mappings, first,
+                [&](size_type r, size_type len) { memcpy(out, m_ptr + r, len); out += len; },
+                [&](size_type, const std::pair<stringT, stringT>& m) { memcpy(out, m.second.data(), m.second.m_size); out += m.second.m_size; });
+            return count;
+        });
+        swap(result);
+        return *this;
+    }
+
     constexpr void resize(size_type count, value_type c = '\0') {
         if (count < m_size) {
             m_ptr[m_size = count] = '\0';
@@ -543,6 +772,7 @@ public:
         std::swap<Allocator>(m_allocator, str.m_allocator);
         std::swap<size_type>(m_size, str.m_size);
         std::swap<pointer>(m_ptr, str.m_ptr);
+        std::swap<size_type>(m_allocated, str.m_allocated);
     }
 
     constexpr stringT substr(size_type pos, size_type count = npos) const {
@@ -560,22 +790,45 @@ public:
 
     constexpr size_type find(const_pointer s, size_type pos, size_type count) const
     {
-        if (pos + count > m_size) return npos;
+        return find_in(m_ptr, m_size, s, pos, count);
+    }
+
+    // Position of [s, s + count) in [pos, len) of a raw buffer, or npos.
+    // The same search as find(), for code that scans only part of a string
+    // or a buffer that isn't a stringT.
+    static constexpr size_type find_in(const_pointer str, size_type len, const_pointer s, size_type pos, size_type count)
+    {
+        if (pos + count > len) return npos;
         if (count == 0) return pos;
 
-        const_pointer pFound = static_cast<const_pointer>(memchr(m_ptr + pos, *s, m_size - pos));
-        size_type i = static_cast<size_type>(pFound - m_ptr);
+        const_pointer pFound = static_cast<const_pointer>(memchr(str + pos, *s, len - pos));
+        size_type i = static_cast<size_type>(pFound - str);
 
-        while (pFound && (i + count) <= m_size) {
+        while (pFound && (i + count) <= len) {
             if (memcmp(pFound, s, count) == 0) {
                 return i;
             }
-            pFound = static_cast<const_pointer>(memchr(pFound + 1, *s, m_size - i - 1));
-            i = static_cast<size_type>(pFound - m_ptr);
+            pFound = static_cast<const_pointer>(memchr(pFound + 1, *s, len - i - 1));
+            i = static_cast<size_type>(pFound - str);
         }
         return npos;
     }
 
+    // Search for a needle known at compile time, using its precomputed
+    // skip table: static constexpr fixed_matcher m(fixed_stringT("GET"));
+    template<size_t N>
+    constexpr size_type find(const fixed_matcher<N, CharT>& matcher, size_type pos = 0) const {
+        return matcher.find(m_ptr, m_size, pos);
+    }
+
+#if __cpp_nontype_template_args >= 201911L
+    // Same, with the matcher generated from the template argument: s.find<"GET">()
+    template<fixed_stringT Needle>
+    constexpr size_type find(size_type pos = 0) const {
+        return find(fixed_matcher_v<Needle>, pos);
+    }
+#endif
+
     constexpr int compare(const stringT& str) const {
         if (m_ptr == str.data() && m_size == str.m_size) {
             return 0;
@@ -589,6 +842,16 @@ public:
         return ((m_size == str.m_size) && (m_ptr == str.data())) || !_compare(m_ptr, m_size, str.data(), str.m_size);
     }
 
+    template<size_t N>
+    constexpr bool operator==(const fixed_stringT<N, CharT>& str) const {
+        return m_size == N && !_compare(m_ptr, m_size, str.data(), N);
+    }
+
+    template<size_t N>
+    constexpr bool operator!=(const fixed_stringT<N, CharT>& str) const {
+        return !(*this == str);
+    }
+
     constexpr inline bool operator!=(const stringT& s) const {
         return !(*this == s);
     }
@@ -611,6 +874,27 @@ public:
 
 };
 
+// std::basic_string has no way to hand over or take its buffer, so these
+// conversions copy exactly once into an exactly sized buffer and free the
+// source right away, keeping peak memory at one copy of the payload.
+template<typename CharT, typename Allocator>
+std::basic_string<CharT> to_std_string(stringT<CharT, Allocator>&& str) {
+    std::basic_string<CharT> result(str.data(), str.size());
+    stringT<CharT, Allocator>().swap(str);
+    return result;
+}
+
+template<typename CharT, typename Allocator = std::allocator<CharT>, typename Traits, typename StdAllocator>
+stringT<CharT, Allocator> from_std_string(std::basic_string<CharT, Traits, StdAllocator>&& str) {
+    stringT<CharT, Allocator> result;
+    result.resize_and_overwrite(str.size(), [&](CharT* p, size_t count) {
+        memcpy(p, str.data(), count * sizeof(CharT));
+        return count;
+    });
+    std::basic_string<CharT, Traits, StdAllocator>().swap(str);
+    return result;
+}
+
 // This might not be needed for class type variables post C++17.
 // However, pointer class type would need it.
 typedef stringT<> string;
\ No newline at end of file
@@ -0,0 +1,357 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "string.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Binary format for a whole collection of strings, made to be used in
+// place: load or memory-map the blob and read every string straight out
+// of it without any per-string allocation.
+//
+// Layout (version 1, every part 8 byte aligned, native byte order):
+//
+//   header     magic "STRBLOB", version, byte order mark, character size,
+//              string count, size of the character area
+//   offsets    count + 1 uint64 offsets into the character area, in
+//              characters; string i is [offsets[i], offsets[i + 1] - 1)
+//   characters every string followed by '\0', padded to 8 bytes
+//
+// serialize_strings writes a blob, string_blob_view reads one,
+// mapped_file maps a blob file into memory and string_blob_view::
+// materialize turns all strings into stringTs sharing one arena block.
+
+namespace string_blob {
+
+    constexpr char magic[8] = { 'S', 'T', 'R', 'B', 'L', 'O', 'B', '\0' };
+    constexpr uint32_t version = 1;
+    constexpr uint32_t byte_order = 0x01020304;
+
+    struct header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t char_size;
+        uint64_t count;
+        uint64_t chars;
+    };
+
+    constexpr size_t align8(size_t n) {
+        return (n + 7) & ~size_t(7);
+    }
+
+}
+
+// Writes the strings in [first, last) as one blob. The range is walked
+// twice: once to size the blob, once to fill it.
+template<typename ForwardIt>
+string serialize_strings(ForwardIt first, ForwardIt last) {
+    typedef typename std::iterator_traits<ForwardIt>::value_type::value_type CharT;
+    using namespace string_blob;
+
+    uint64_t count = 0, chars = 0;
+    for (ForwardIt it = first; it != last; ++it) {
+        count++;
+        chars += it->size() + 1;
+    }
+    const size_t offsetsAt = sizeof(header);
+    const size_t charsAt = offsetsAt + (count + 1) * sizeof(uint64_t);
+    const size_t total = charsAt + align8(chars * sizeof(CharT));
+
+    string blob;
+    blob.resize_and_overwrite(total, [&](char* p, size_t size) {
+        memset(p, 0, size);
+        header h = {};
+        memcpy(h.magic, magic, sizeof(magic));
+        h.version = version;
+        h.byte_order = byte_order;
+        h.char_size = sizeof(CharT);
+        h.count = count;
+        h.chars = chars;
+        memcpy(p, &h, sizeof(h));
+
+        uint64_t offset = 0;
+        uint64_t i = 0;
+        for (ForwardIt it = first; it != last; ++it, ++i) {
+            memcpy(p + offsetsAt + i * sizeof(uint64_t), &offset, sizeof(offset));
+            if (it->size() != 0) {
+                memcpy(p + charsAt + offset * sizeof(CharT), it->data(), it->size() * sizeof(CharT));
+            }
+            offset += it->size() + 1;
+        }
+        memcpy(p + offsetsAt + count * sizeof(uint64_t), &offset, sizeof(offset));
+        return size;
+    });
+    return blob;
+}
+
+// Monotonic arena: hands out memory from large blocks and frees it all at
+// once when destroyed.
+class string_arena {
+public:
+    explicit string_arena(size_t blockSize = 64 * 1024) : m_blockSize(blockSize) {}
+
+    string_arena(const string_arena&) = delete;
+    string_arena& operator=(const string_arena&) = delete;
+
+    ~string_arena() {
+        for (void* b : m_blocks) {
+            ::operator delete(b);
+        }
+    }
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        size_t at = (m_used + align - 1) & ~(align - 1);
+        if (m_blocks.empty() || at + bytes > m_capacity) {
+            m_capacity = std::max(bytes, m_blockSize);
+            m_blocks.push_back(::operator new(m_capacity));
+            at = 0;
+        }
+        m_used = at + bytes;
+        return static_cast<char*>(m_blocks.back()) + at;
+    }
+
+private:
+    size_t m_blockSize;
+    size_t m_used = 0;
+    size_t m_capacity = 0;
+    std::vector<void*> m_blocks;
+};
+
+// Allocator carving memory out of a string_arena; deallocate does nothing.
+// A default constructed one, as used by stringT's copy constructor, falls
+// back to std::allocator.
+template<typename T>
+class arena_allocator {
+public:
+    typedef T value_type;
+
+    arena_allocator() noexcept = default;
+    explicit arena_allocator(string_arena& arena) noexcept : m_arena(&arena) {}
+
+    template<typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept : m_arena(other.arena()) {}
+
+    T* allocate(size_t n) {
+        if (m_arena == nullptr) {
+            return std::allocator<T>().allocate(n);
+        }
+        return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (m_arena == nullptr && p != nullptr) {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    string_arena* arena() const noexcept {
+        return m_arena;
+    }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U>& other) const noexcept {
+        return m_arena == other.arena();
+    }
+
+    template<typename U>
+    bool operator!=(const arena_allocator<U>& other) const noexcept {
+        return m_arena != other.arena();
+    }
+
+private:
+    string_arena* m_arena = nullptr;
+};
+
+// Read-only view of a blob in memory. Nothing is copied: every string is
+// handed out as a view into the blob, which must outlive the view.
+template<typename CharT = char>
+class string_blob_view {
+public:
+    typedef CharT value_type;
+    typedef size_t size_type;
+    typedef std::basic_string_view<CharT> view_type;
+
+    string_blob_view() = default;
+
+    // Checks the header and that the offsets rise; the characters
+    // themselves are not read, so opening a mapped file only touches its
+    // offset table. data must be 8 byte aligned. Returns false, leaving
+    // the view empty, if the blob is malformed or was written for another
+    // version, character size or byte order.
+    bool open(const void* data, size_type bytes) {
+        using namespace string_blob;
+        *this = string_blob_view();
+        if (data == nullptr || bytes < sizeof(header) || reinterpret_cast<uintptr_t>(data) % 8) {
+            return false;
+        }
+
+        const header* h = static_cast<const header*>(data);
+        if (memcmp(h->magic, magic, sizeof(magic)) != 0 || h->version != version
+            || h->byte_order != byte_order || h->char_size != sizeof(CharT)) {
+            return false;
+        }
+        const size_type available = bytes - sizeof(header);
+        if (h->count >= available / sizeof(uint64_t)
+            || h->chars > (available - (h->count + 1) * sizeof(uint64_t)) / sizeof(CharT)) {
+            return false;
+        }
+
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>(h + 1);
+        const CharT* chars = reinterpret_cast<const CharT*>(offsets + h->count + 1);
+        // Offsets must rise and stay in the character area. Every string
+        // then has room for its '\0', which c_str checks when asked.
+        if (offsets[0] != 0 || offsets[h->count] != h->chars) {
+            return false;
+        }
+        for (uint64_t i = 0; i < h->count; i++) {
+            if (offsets[i + 1] <= offsets[i] || offsets[i + 1] > h->chars) {
+                return false;
+            }
+        }
+
+        m_count = h->count;
+        m_offsets = offsets;
+        m_chars = chars;
+        return true;
+    }
+
+    size_type size() const noexcept {
+        return m_count;
+    }
+
+    bool empty() const noexcept {
+        return m_count == 0;
+    }
+
+    view_type operator[](size_type i) const {
+        assert(i < m_count);
+        return view_type(m_chars + m_offsets[i], m_offsets[i + 1] - m_offsets[i] - 1);
+    }
+
+    // Null terminated string i, or nullptr if the blob lacks its '\0'
+    const CharT* c_str(size_type i) const {
+        assert(i < m_count);
+        return m_chars[m_offsets[i + 1] - 1] == CharT() ? m_chars + m_offsets[i] : nullptr;
+    }
+
+    // Copies every string into stringTs whose buffers all live in one
+    // block of arena: one allocation and one copy for the whole set. The
+    // copies are always null terminated. The arena must outlive the
+    // strings.
+    std::vector<stringT<CharT, arena_allocator<CharT>>> materialize(string_arena& arena) const {
+        typedef stringT<CharT, arena_allocator<CharT>> arena_string;
+        std::vector<arena_string> result(m_count);
+        if (m_count == 0) {
+            return result;
+        }
+
+        const size_type chars = m_offsets[m_count];
+        CharT* block = static_cast<CharT*>(arena.allocate(chars * sizeof(CharT), alignof(CharT)));
+        memcpy(block, m_chars, chars * sizeof(CharT));
+        const arena_allocator<CharT> allocator(arena);
+        for (size_type i = 0; i < m_count; i++) {
+            const size_type len = m_offsets[i + 1] - m_offsets[i];
+            block[m_offsets[i + 1] - 1] = CharT();
+            result[i].adopt(block + m_offsets[i], len - 1, len, allocator);
+        }
+        return result;
+    }
+
+private:
+    size_type m_count = 0;
+    const uint64_t* m_offsets = nullptr;
+    const CharT* m_chars = nullptr;
+};
+
+// Read-only memory mapping of a whole file
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file() {
+        close();
+    }
+
+    bool open(const char* path) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            return false;
+        }
+        m_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (m_data == nullptr) {
+            return false;
+        }
+        m_size = static_cast<size_t>(size.QuadPart);
+#else
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        m_data = p;
+        m_size = static_cast<size_t>(st.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+        if (m_data == nullptr) {
+            return;
+        }
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(m_data, m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const void* data() const noexcept {
+        return m_data;
+    }
+
+    size_t size() const noexcept {
+        return m_size;
+    }
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+};
@@ -0,0 +1,320 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include "string.h"
+
+// Thread-local buffer cache for stringT storage.
+//
+// cached_allocator<CharT> keeps freed buffers in per-thread free lists,
+// one per power-of-two block size, and hands them out again on the next
+// allocation of that size class. Switching a string type over is just
+//
+//   typedef stringT<char, cached_allocator<char>> cached_string;
+//
+// Every cached block starts with a small header naming the thread cache
+// it came from. A block freed on its own thread goes back onto that
+// thread's list; a block freed on any other thread is pushed onto the
+// owner's lock-free "remote" list, which the owner takes back the next
+// time it runs out of blocks of some size. A thread cache outlives its
+// thread until the last of its blocks has been freed.
+//
+// Each thread keeps at most retain_limit() bytes in its lists; anything
+// freed beyond that, and any request larger than the biggest size class,
+// goes straight to the global allocator.
+
+namespace string_cache {
+
+    // Block sizes, header included: 2^min_class .. 2^max_class bytes
+    constexpr size_t min_class = 5;
+    constexpr size_t max_class = 16;
+    constexpr size_t classes = max_class - min_class + 1;
+
+    struct stats {
+        // Allocations served from the cache
+        size_t hits = 0;
+        // Allocations that went to the global allocator
+        size_t misses = 0;
+        // Blocks this thread freed for another thread
+        size_t remote_frees = 0;
+        // Bytes currently held in this thread's free lists
+        size_t retained = 0;
+    };
+
+    class cache;
+
+    struct alignas(std::max_align_t) header {
+        cache* owner;
+        size_t cls;
+    };
+
+    struct node {
+        node* next;
+    };
+
+    inline std::atomic<size_t>& retain_limit_value() {
+        static std::atomic<size_t> limit{ size_t(1) << 20 };
+        return limit;
+    }
+
+    // Size class holding bytes plus the header, or classes if too large
+    inline size_t class_of(size_t bytes) {
+        const size_t need = bytes + sizeof(header);
+        size_t cls = min_class;
+        while (cls <= max_class && (size_t(1) << cls) < need) cls++;
+        return cls - min_class;
+    }
+
+    class cache {
+    public:
+        cache() = default;
+        cache(const cache&) = delete;
+        cache& operator=(const cache&) = delete;
+
+        ~cache() {
+            _release_remote();
+        }
+
+        // This thread's cache, created on first use
+        static cache& local();
+
+        // This thread's cache, or nullptr if it has none
+        static cache* local_if_any();
+
+        void* allocate(size_t cls) {
+            if (m_free[cls] == nullptr && m_remote.load(std::memory_order_relaxed) != nullptr) {
+                _take_remote();
+            }
+
+            header* h;
+            if (node* n = m_free[cls]) {
+                m_free[cls] = n->next;
+                m_stats.retained -= _block_size(cls);
+                m_stats.hits++;
+                h = reinterpret_cast<header*>(n);
+            }
+            else {
+                m_stats.misses++;
+                h = static_cast<header*>(::operator new(_block_size(cls)));
+            }
+            h->owner = this;
+            h->cls = cls;
+            m_refs.fetch_add(1, std::memory_order_relaxed);
+            return h + 1;
+        }
+
+        // Frees a block owned by this cache on its own thread
+        void free_local(header* h) {
+            const size_t size = _block_size(h->cls);
+            if (m_stats.retained + size <= retain_limit_value().load(std::memory_order_relaxed)) {
+                _push(h);
+                m_stats.retained += size;
+            }
+            else {
+                ::operator delete(h);
+            }
+            // The thread's own reference keeps this above zero
+            m_refs.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // Frees a block owned by this cache from another thread
+        void free_remote(header* h) {
+            if (m_orphaned.load(std::memory_order_acquire)) {
+                ::operator delete(h);
+            }
+            else {
+                node* n = reinterpret_cast<node*>(h);
+                n->next = m_remote.load(std::memory_order_relaxed);
+                while (!m_remote.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed)) {
+                }
+            }
+            _release();
+        }
+
+        // Returns every block in the free lists to the global allocator
+        void trim() {
+            _take_remote();
+            for (size_t cls = 0; cls < classes; cls++) {
+                while (node* n = m_free[cls]) {
+                    m_free[cls] = n->next;
+                    ::operator delete(n);
+                }
+            }
+            m_stats.retained = 0;
+        }
+
+        // Called when the owning thread exits
+        void orphan() {
+            m_orphaned.store(true, std::memory_order_release);
+            trim();
+            _release();
+        }
+
+        stats& get_stats() noexcept {
+            return m_stats;
+        }
+
+    private:
+        node* m_free[classes] = {};
+        stats m_stats;
+        // Blocks freed by other threads, waiting to be taken back
+        std::atomic<node*> m_remote{ nullptr };
+        // Outstanding blocks, plus one while the thread is alive
+        std::atomic<size_t> m_refs{ 1 };
+        std::atomic<bool> m_orphaned{ false };
+
+        static size_t _block_size(size_t cls) noexcept {
+            return size_t(1) << (cls + min_class);
+        }
+
+        void _push(header* h) {
+            node* n = reinterpret_cast<node*>(h);
+            const size_t cls = h->cls;
+            n->next = m_free[cls];
+            m_free[cls] = n;
+        }
+
+        // Moves the remote list into the free lists, over the limit or not:
+        // these blocks were allocated here to begin with.
+        void _take_remote() {
+            node* n = m_remote.exchange(nullptr, std::memory_order_acquire);
+            while (n) {
+                node* next = n->next;
+                header* h = reinterpret_cast<header*>(n);
+                // The link overwrote the owner, the size class is intact
+                m_stats.retained += _block_size(h->cls);
+                _push(h);
+                n = next;
+            }
+        }
+
+        void _release_remote() {
+            node* n = m_remote.exchange(nullptr, std::memory_order_acquire);
+            while (n) {
+                node* next = n->next;
+                ::operator delete(n);
+                n = next;
+            }
+        }
+
+        void _release() {
+            if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete this;
+            }
+        }
+    };
+
+    struct holder {
+        cache* c = nullptr;
+
+        ~holder() {
+            if (c) {
+                cache* old = c;
+                c = nullptr;
+                old->orphan();
+            }
+        }
+    };
+
+    inline thread_local holder t_holder;
+
+    inline cache& cache::local() {
+        if (t_holder.c == nullptr) {
+            t_holder.c = new cache();
+        }
+        return *t_holder.c;
+    }
+
+    inline cache* cache::local_if_any() {
+        return t_holder.c;
+    }
+
+    inline void* allocate(size_t bytes) {
+        const size_t cls = class_of(bytes);
+        cache& c = cache::local();
+        if (cls >= classes) {
+            // Too large to cache, but still a trip to the global allocator
+            c.get_stats().misses++;
+            return ::operator new(bytes);
+        }
+        return c.allocate(cls);
+    }
+
+    inline void deallocate(void* p, size_t bytes) noexcept {
+        if (p == nullptr) {
+            return;
+        }
+        if (class_of(bytes) >= classes) {
+            ::operator delete(p);
+            return;
+        }
+        header* h = static_cast<header*>(p) - 1;
+        cache* owner = h->owner;
+        if (owner == cache::local_if_any()) {
+            owner->free_local(h);
+        }
+        else {
+            if (cache* self = cache::local_if_any()) {
+                self->get_stats().remote_frees++;
+            }
+            owner->free_remote(h);
+        }
+    }
+
+    // Most bytes a thread keeps in its free lists (default 1 MiB)
+    inline size_t retain_limit() {
+        return retain_limit_value().load(std::memory_order_relaxed);
+    }
+
+    inline void set_retain_limit(size_t bytes) {
+        retain_limit_value().store(bytes, std::memory_order_relaxed);
+    }
+
+    // Statistics of the calling thread's cache
+    inline stats thread_stats() {
+        cache* c = cache::local_if_any();
+        return c ? c->get_stats() : stats();
+    }
+
+    // Empties the calling thread's free lists
+    inline void trim() {
+        if (cache* c = cache::local_if_any()) {
+            c->trim();
+        }
+    }
+
+}
+
+// Allocator backed by string_cache. Stateless: any instance can free
+// memory from any other, on any thread.
+template<typename T>
+class cached_allocator {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "cached_allocator only provides max_align_t alignment");
+public:
+    typedef T value_type;
+
+    cached_allocator() noexcept = default;
+
+    template<typename U>
+    cached_allocator(const cached_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(string_cache::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        string_cache::deallocate(p, n * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const cached_allocator<U>&) const noexcept {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const cached_allocator<U>&) const noexcept {
+        return false;
+    }
+};
+
+typedef stringT<char, cached_allocator<char>> cached_string;
@@ -0,0 +1,332 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "string.h"
+
+// Immutable, memory-dense dictionary of sorted keys with ids 0 .. size() - 1
+// in key order.
+//
+// Keys are front coded in blocks: the first key of every block is stored
+// whole, every other key as the length of the prefix it shares with the
+// key before it plus the remaining suffix. Lengths are varints and all
+// blocks live in one byte buffer, so long shared prefixes such as URLs or
+// paths are stored about once per block instead of once per key. A
+// sampled index holds the offset of every block; a lookup binary searches
+// the blocks' first keys and decodes only the one block that can hold the
+// key.
+//
+// Keys compare byte-wise as unsigned, the same as stringT::compare.
+
+class string_dictionary {
+public:
+    typedef size_t size_type;
+    static constexpr size_type npos = size_type(-1);
+
+    class const_iterator;
+
+    string_dictionary() = default;
+
+    // Builds from [first, last), which must be sorted with no duplicates,
+    // in one pass. Larger blocks save memory, smaller ones speed up lookups.
+    template<typename ForwardIt>
+    string_dictionary(ForwardIt first, ForwardIt last, size_type blockSize = 16) : m_blockSize(blockSize) {
+        assert(blockSize > 0);
+        const char* prev = nullptr;
+        size_type prevLen = 0;
+        for (; first != last; ++first, m_size++) {
+            const char* key = first->data();
+            const size_type len = first->size();
+            if (m_size % m_blockSize == 0) {
+                m_blocks.push_back(m_data.size());
+                _put_varint(len);
+                _put(key, len);
+            }
+            else {
+                const size_type lcp = _common_prefix(prev, prevLen, key, len);
+                assert(lcp < len && (lcp == prevLen || static_cast<unsigned char>(prev[lcp]) < static_cast<unsigned char>(key[lcp])));
+                _put_varint(lcp);
+                _put_varint(len - lcp);
+                _put(key + lcp, len - lcp);
+            }
+            prev = key;
+            prevLen = len;
+        }
+        m_data.shrink_to_fit();
+        m_blocks.shrink_to_fit();
+    }
+
+    size_type size() const noexcept {
+        return m_size;
+    }
+
+    bool empty() const noexcept {
+        return m_size == 0;
+    }
+
+    // Bytes used by the encoded keys and the block index
+    size_type memory_usage() const noexcept {
+        return m_data.capacity() + m_blocks.capacity() * sizeof(size_type);
+    }
+
+    // Id of key, or npos if it isn't in the dictionary
+    size_type lookup(const char* key, size_type len) const {
+        return lower_bound(key, len, true);
+    }
+
+    template<typename Allocator>
+    size_type lookup(const stringT<char, Allocator>& key) const {
+        return lookup(key.data(), key.size());
+    }
+
+    // Id of the first key not less than key, or size()
+    size_type lower_bound(const char* key, size_type len) const {
+        return lower_bound(key, len, false);
+    }
+
+    // Writes key id into out
+    template<typename Allocator>
+    void extract(size_type id, stringT<char, Allocator>& out) const {
+        assert(id < m_size);
+        const size_type block = id / m_blockSize;
+        const unsigned char* p = _block(block);
+        size_type len = 0;
+        p = _read_head(p, out, len);
+        for (size_type i = block * m_blockSize; i < id; i++) {
+            p = _read_next(p, out, len);
+        }
+    }
+
+    // Ids [first, second) of the keys starting with prefix
+    std::pair<size_type, size_type> prefix_range(const char* prefix, size_type len) const {
+        const size_type first = lower_bound(prefix, len);
+        // The smallest string greater than every key with this prefix:
+        // the prefix with its last byte below 0xff incremented
+        size_type n = len;
+        while (n > 0 && static_cast<unsigned char>(prefix[n - 1]) == 0xff) n--;
+        if (n == 0) {
+            return { first, m_size };
+        }
+        string upper(prefix, n);
+        upper[n - 1] = static_cast<char>(static_cast<unsigned char>(upper[n - 1]) + 1);
+        return { first, lower_bound(upper.data(), n) };
+    }
+
+    template<typename Allocator>
+    std::pair<size_type, size_type> prefix_range(const stringT<char, Allocator>& prefix) const {
+        return prefix_range(prefix.data(), prefix.size());
+    }
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // Iterator at key id
+    const_iterator at(size_type id) const;
+
+private:
+    size_type m_size = 0;
+    size_type m_blockSize = 16;
+    std::vector<unsigned char> m_data;
+    // Offset of every block in m_data
+    std::vector<size_type> m_blocks;
+
+    static size_type _common_prefix(const char* a, size_type alen, const char* b, size_type blen) {
+        const size_type n = std::min(alen, blen);
+        size_type i = 0;
+        while (i < n && a[i] == b[i]) i++;
+        return i;
+    }
+
+    static int _compare_byte(char a, char b) {
+        return static_cast<int>(static_cast<unsigned char>(a)) - static_cast<int>(static_cast<unsigned char>(b));
+    }
+
+    void _put_varint(size_type v) {
+        while (v >= 0x80) {
+            m_data.push_back(static_cast<unsigned char>(v | 0x80));
+            v >>= 7;
+        }
+        m_data.push_back(static_cast<unsigned char>(v));
+    }
+
+    void _put(const char* s, size_type len) {
+        m_data.insert(m_data.end(), s, s + len);
+    }
+
+    static const unsigned char* _get_varint(const unsigned char* p, size_type& v) {
+        v = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            const unsigned char b = *p++;
+            v |= size_type(b & 0x7f) << shift;
+            if (!(b & 0x80)) return p;
+        }
+    }
+
+    const unsigned char* _block(size_type block) const {
+        return m_data.data() + m_blocks[block];
+    }
+
+    // Key at the start of a block, without copying
+    const unsigned char* _head(size_type block, const char*& key, size_type& len) const {
+        const unsigned char* p = _get_varint(_block(block), len);
+        key = reinterpret_cast<const char*>(p);
+        return p + len;
+    }
+
+    template<typename Allocator>
+    static const unsigned char* _read_head(const unsigned char* p, stringT<char, Allocator>& out, size_type& len) {
+        p = _get_varint(p, len);
+        out.resize_and_overwrite(len, [&](char* d, size_type count) {
+            memcpy(d, p, count);
+            return count;
+        });
+        return p + len;
+    }
+
+    // Decodes the key after out, which holds the previous one
+    template<typename Allocator>
+    static const unsigned char* _read_next(const unsigned char* p, stringT<char, Allocator>& out, size_type& len) {
+        size_type lcp, suffix;
+        p = _get_varint(p, lcp);
+        p = _get_varint(p, suffix);
+        len = lcp + suffix;
+        out.resize_and_overwrite(len, [&](char* d, size_type count) {
+            memcpy(d + lcp, p, suffix);
+            return count;
+        });
+        return p + suffix;
+    }
+
+    // First id whose key is >= key; with exact, the id of key or npos
+    size_type lower_bound(const char* key, size_type len, bool exact) const {
+        if (m_size == 0) {
+            return exact ? npos : 0;
+        }
+
+        // Last block whose first key is <= key
+        size_type lo = 0, hi = m_blocks.size();
+        while (hi - lo > 1) {
+            const size_type mid = lo + (hi - lo) / 2;
+            const char* head;
+            size_type headLen;
+            _head(mid, head, headLen);
+            const size_type n = std::min(len, headLen);
+            const int c = memcmp(head, key, n);
+            if (c < 0 || (c == 0 && headLen <= len)) lo = mid;
+            else hi = mid;
+        }
+
+        const char* head;
+        size_type headLen;
+        const unsigned char* p = _head(lo, head, headLen);
+        size_type id = lo * m_blockSize;
+        // m: prefix the current key shares with key
+        size_type m = _common_prefix(head, headLen, key, len);
+        if (m == len || (m < headLen && _compare_byte(head[m], key[m]) > 0)) {
+            // The block's first key is >= key, only possible in block 0
+            return (m == len && m == headLen) ? id : (exact ? npos : id);
+        }
+
+        // The current key is < key. Walk the block: a following key that
+        // shares less than m characters with the current one is already
+        // greater than key, one that shares more is still smaller.
+        const size_type end = std::min(m_size, id + m_blockSize);
+        for (id++; id < end; id++) {
+            size_type lcp, suffix;
+            p = _get_varint(p, lcp);
+            p = _get_varint(p, suffix);
+            const char* s = reinterpret_cast<const char*>(p);
+            p += suffix;
+            if (lcp < m) {
+                return exact ? npos : id;
+            }
+            if (lcp > m) {
+                continue;
+            }
+            // Compare the suffix with key from position m
+            size_type k = 0;
+            while (k < suffix && m + k < len && s[k] == key[m + k]) k++;
+            m += k;
+            const size_type curLen = lcp + suffix;
+            if (m == len) {
+                return (curLen == len || !exact) ? id : npos;
+            }
+            if (k < suffix && _compare_byte(s[k], key[m]) > 0) {
+                return exact ? npos : id;
+            }
+        }
+        return exact ? npos : end;
+    }
+
+    friend class const_iterator;
+};
+
+// Forward iterator decoding keys in order into a buffer it owns
+class string_dictionary::const_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = string;
+    using reference = const string&;
+    using pointer = const string*;
+    using difference_type = ptrdiff_t;
+
+    const_iterator() = default;
+
+    reference operator*() const { return m_key; }
+    pointer operator->() const { return &m_key; }
+
+    // Id of the current key
+    size_type id() const noexcept { return m_id; }
+
+    const_iterator& operator++() {
+        if (++m_id < m_dict->m_size) {
+            if (m_id % m_dict->m_blockSize == 0) {
+                m_next = _read_head(m_next, m_key, m_len);
+            }
+            else {
+                m_next = _read_next(m_next, m_key, m_len);
+            }
+        }
+        return *this;
+    }
+
+    const_iterator operator++(int) { const_iterator tmp(*this); ++(*this); return tmp; }
+
+    bool operator==(const const_iterator& rhs) const { return m_id == rhs.m_id; }
+    bool operator!=(const const_iterator& rhs) const { return m_id != rhs.m_id; }
+
+private:
+    friend class string_dictionary;
+
+    const string_dictionary* m_dict = nullptr;
+    size_type m_id = 0;
+    const unsigned char* m_next = nullptr;
+    string m_key;
+    size_type m_len = 0;
+
+    const_iterator(const string_dictionary* dict, size_type id) : m_dict(dict), m_id(id) {
+        if (id >= dict->m_size) {
+            m_id = dict->m_size;
+            return;
+        }
+        const size_type block = id / dict->m_blockSize;
+        m_next = _read_head(dict->_block(block), m_key, m_len);
+        for (size_type i = block * dict->m_blockSize; i < id; i++) {
+            m_next = _read_next(m_next, m_key, m_len);
+        }
+    }
+};
+
+inline string_dictionary::const_iterator string_dictionary::begin() const {
+    return const_iterator(this, 0);
+}
+
+inline string_dictionary::const_iterator string_dictionary::end() const {
+    return const_iterator(this, m_size);
+}
+
+inline string_dictionary::const_iterator string_dictionary::at(size_type id) const {
+    return const_iterator(this, id);
+}
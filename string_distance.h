@@ -0,0 +1,346 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "string.h"
+
+// Edit distance and similarity between two strings.
+//
+// Levenshtein distance and LCS length use the bit-parallel algorithms of
+// Myers (1999) and Hyyro (2004): one column of the DP table is kept as
+// bit vectors over the shorter string, so a column costs a handful of word
+// operations instead of one cell per character. Strings up to 64
+// characters fit one word; longer ones are split into 64 character
+// blocks. No DP table is ever allocated.
+//
+// The bit vectors are indexed by character, so these work on single-byte
+// character types only.
+
+namespace string_distance {
+
+    typedef uint64_t word;
+    constexpr size_t word_bits = 64;
+
+    inline size_t popcount(word w) {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<size_t>(__builtin_popcountll(w));
+#else
+        size_t n = 0;
+        for (; w; w &= w - 1) n++;
+        return n;
+#endif
+    }
+
+    // Match masks of a pattern: bit i of eq(b, c) is set if p[64 * b + i] == c
+    template<typename CharT>
+    class pattern {
+        static_assert(sizeof(CharT) == 1, "string_distance works on single-byte characters");
+    public:
+        typedef size_t size_type;
+
+        pattern(const CharT* p, size_type len) : m_size(len), m_blocks((len + word_bits - 1) / word_bits) {
+            if (m_blocks <= 1) {
+                m_eq = m_single;
+                std::fill(m_single, m_single + 256, word(0));
+            }
+            else {
+                m_multi.assign(256 * m_blocks, 0);
+                m_eq = m_multi.data();
+            }
+            for (size_type i = 0; i < len; i++) {
+                m_eq[_index(p[i]) * m_blocks + i / word_bits] |= word(1) << (i % word_bits);
+            }
+        }
+
+        pattern(const pattern&) = delete;
+        pattern& operator=(const pattern&) = delete;
+
+        size_type size() const noexcept {
+            return m_size;
+        }
+
+        size_type blocks() const noexcept {
+            return m_blocks;
+        }
+
+        word eq(size_type block, CharT c) const noexcept {
+            return m_eq[_index(c) * m_blocks + block];
+        }
+
+        // The bit of the last pattern character in the last block
+        word last_bit() const noexcept {
+            return word(1) << ((m_size - 1) % word_bits);
+        }
+
+    private:
+        size_type m_size;
+        size_type m_blocks;
+        // Patterns of up to 64 characters keep their masks inline
+        word m_single[256];
+        std::vector<word> m_multi;
+        word* m_eq;
+
+        static size_type _index(CharT c) noexcept {
+            return static_cast<unsigned char>(c);
+        }
+    };
+
+    // Levenshtein distance between pattern p and text t, giving up with
+    // max + 1 once the distance is certain to exceed max.
+    template<typename CharT>
+    size_t levenshtein(const pattern<CharT>& p, const CharT* t, size_t n, size_t max = size_t(-1)) {
+        const size_t m = p.size();
+        if (m == 0) return n <= max ? n : max + 1;
+        if ((m > n ? m - n : n - m) > max) return max + 1;
+
+        size_t score = m;
+        if (p.blocks() == 1) {
+            const word last = p.last_bit();
+            word vp = ~word(0), vn = 0;
+            for (size_t j = 0; j < n; j++) {
+                const word eq = p.eq(0, t[j]);
+                const word xv = eq | vn;
+                const word xh = (((eq & vp) + vp) ^ vp) | eq;
+                word hp = vn | ~(xh | vp);
+                word hn = vp & xh;
+                if (hp & last) score++;
+                else if (hn & last) score--;
+                // Every remaining column lowers the score by at most one
+                if (score > max && score - max > n - j - 1) return max + 1;
+                hp = (hp << 1) | 1;
+                hn <<= 1;
+                vp = hn | ~(xv | hp);
+                vn = hp & xv;
+            }
+            return score <= max ? score : max + 1;
+        }
+
+        // Blocked version: the horizontal delta leaving the bottom of one
+        // block is carried into the top of the next.
+        const size_t b = p.blocks();
+        const word last = p.last_bit();
+        const word high = word(1) << (word_bits - 1);
+        std::vector<word> vp(b, ~word(0)), vn(b, 0);
+        for (size_t j = 0; j < n; j++) {
+            int hin = 1;
+            for (size_t k = 0; k < b; k++) {
+                word eq = p.eq(k, t[j]);
+                const word xv = eq | vn[k];
+                if (hin < 0) eq |= 1;
+                const word xh = (((eq & vp[k]) + vp[k]) ^ vp[k]) | eq;
+                word hp = vn[k] | ~(xh | vp[k]);
+                word hn = vp[k] & xh;
+                const word out = (k + 1 == b) ? last : high;
+                const int hout = (hp & out) ? 1 : ((hn & out) ? -1 : 0);
+                hp <<= 1;
+                hn <<= 1;
+                if (hin < 0) hn |= 1;
+                else if (hin > 0) hp |= 1;
+                vp[k] = hn | ~(xv | hp);
+                vn[k] = hp & xv;
+                hin = hout;
+            }
+            score += hin;
+            if (score > max && score - max > n - j - 1) return max + 1;
+        }
+        return score <= max ? score : max + 1;
+    }
+
+    // Restricted Damerau-Levenshtein (optimal string alignment) distance,
+    // Hyyro 2003. Patterns longer than 64 characters use a three row DP.
+    template<typename CharT>
+    size_t damerau(const pattern<CharT>& p, const CharT* s, const CharT* t, size_t n) {
+        const size_t m = p.size();
+        if (m == 0) return n;
+
+        if (p.blocks() == 1) {
+            const word last = p.last_bit();
+            word vp = ~word(0), vn = 0, d0 = 0, eqPrev = 0;
+            size_t score = m;
+            for (size_t j = 0; j < n; j++) {
+                const word eq = p.eq(0, t[j]);
+                const word tr = (((~d0) & eq) << 1) & eqPrev;
+                d0 = (((eq & vp) + vp) ^ vp) | eq | vn | tr;
+                word hp = vn | ~(d0 | vp);
+                word hn = d0 & vp;
+                if (hp & last) score++;
+                else if (hn & last) score--;
+                hp = (hp << 1) | 1;
+                hn <<= 1;
+                vp = hn | ~(d0 | hp);
+                vn = hp & d0;
+                eqPrev = eq;
+            }
+            return score;
+        }
+
+        std::vector<size_t> rows(3 * (m + 1));
+        size_t* prev2 = rows.data();
+        size_t* prev = prev2 + m + 1;
+        size_t* cur = prev + m + 1;
+        for (size_t i = 0; i <= m; i++) prev[i] = i;
+        for (size_t j = 1; j <= n; j++) {
+            cur[0] = j;
+            for (size_t i = 1; i <= m; i++) {
+                const size_t cost = s[i - 1] == t[j - 1] ? 0 : 1;
+                cur[i] = std::min({ prev[i] + 1, cur[i - 1] + 1, prev[i - 1] + cost });
+                if (i > 1 && j > 1 && s[i - 1] == t[j - 2] && s[i - 2] == t[j - 1]) {
+                    cur[i] = std::min(cur[i], prev2[i - 2] + 1);
+                }
+            }
+            std::swap(prev2, prev);
+            std::swap(prev, cur);
+        }
+        return prev[m];
+    }
+
+    // Length of the longest common subsequence, Hyyro 2004. Each block
+    // carries its addition into the next.
+    template<typename CharT>
+    size_t lcs(const pattern<CharT>& p, const CharT* t, size_t n) {
+        const size_t m = p.size();
+        if (m == 0) return 0;
+
+        const size_t b = p.blocks();
+        std::vector<word> multi;
+        word single = ~word(0);
+        word* s = &single;
+        if (b > 1) {
+            multi.assign(b, ~word(0));
+            s = multi.data();
+        }
+        for (size_t j = 0; j < n; j++) {
+            word carry = 0;
+            for (size_t k = 0; k < b; k++) {
+                const word u = s[k] & p.eq(k, t[j]);
+                const word sum = s[k] + u;
+                const word x = sum + carry;
+                carry = (sum < u) | (x < carry);
+                s[k] = x | (s[k] - u);
+            }
+        }
+
+        size_t ones = 0;
+        for (size_t k = 0; k + 1 < b; k++) ones += popcount(s[k]);
+        const size_t tail = m - (b - 1) * word_bits;
+        const word mask = tail == word_bits ? ~word(0) : (word(1) << tail) - 1;
+        ones += popcount(s[b - 1] & mask);
+        return m - ones;
+    }
+
+    // Number of candidates scored side by side by levenshtein_batch
+    constexpr size_t lanes = 4;
+
+}
+
+template<typename CharT, typename Allocator>
+size_t levenshtein(const stringT<CharT, Allocator>& a, const stringT<CharT, Allocator>& b) {
+    // The shorter string becomes the bit vectors
+    const auto& p = a.size() <= b.size() ? a : b;
+    const auto& t = a.size() <= b.size() ? b : a;
+    const string_distance::pattern<CharT> pat(p.data(), p.size());
+    return string_distance::levenshtein(pat, t.data(), t.size());
+}
+
+// Levenshtein distance if it is at most max, otherwise max + 1. Stops as
+// soon as the remaining characters can no longer bring it down to max.
+template<typename CharT, typename Allocator>
+size_t levenshtein_bounded(const stringT<CharT, Allocator>& a, const stringT<CharT, Allocator>& b, size_t max) {
+    const size_t diff = a.size() > b.size() ? a.size() - b.size() : b.size() - a.size();
+    if (diff > max) return max + 1;
+    const auto& p = a.size() <= b.size() ? a : b;
+    const auto& t = a.size() <= b.size() ? b : a;
+    const string_distance::pattern<CharT> pat(p.data(), p.size());
+    return string_distance::levenshtein(pat, t.data(), t.size(), max);
+}
+
+// Optimal string alignment distance: Levenshtein plus transposition of
+// two adjacent characters, each substring edited at most once.
+template<typename CharT, typename Allocator>
+size_t damerau_levenshtein(const stringT<CharT, Allocator>& a, const stringT<CharT, Allocator>& b) {
+    const auto& p = a.size() <= b.size() ? a : b;
+    const auto& t = a.size() <= b.size() ? b : a;
+    const string_distance::pattern<CharT> pat(p.data(), p.size());
+    return string_distance::damerau(pat, p.data(), t.data(), t.size());
+}
+
+template<typename CharT, typename Allocator>
+size_t lcs_length(const stringT<CharT, Allocator>& a, const stringT<CharT, Allocator>& b) {
+    const auto& p = a.size() <= b.size() ? a : b;
+    const auto& t = a.size() <= b.size() ? b : a;
+    const string_distance::pattern<CharT> pat(p.data(), p.size());
+    return string_distance::lcs(pat, t.data(), t.size());
+}
+
+// Scores query against every string in [first, last), writing the
+// distances to out; distances above max are written as max + 1. The
+// query's bit vectors are built once. A query of up to 64 characters is
+// run against several candidates at a time, one per lane. The lanes are
+// independent, so their word operations overlap in the pipeline instead
+// of waiting on each other; a lane past the end of its candidate reads a
+// padding character and has its updates masked off, so the loop body has
+// no branches. (Wider lanes that GCC turns into AVX2 code measured slower
+// than this: the per-character table lookups stay scalar and have to be
+// moved into vector registers on every step.)
+template<typename CharT, typename Allocator, typename InputIt, typename OutputIt>
+OutputIt levenshtein_batch(const stringT<CharT, Allocator>& query, InputIt first, InputIt last, OutputIt out,
+    size_t max = size_t(-1)) {
+    using namespace string_distance;
+    const pattern<CharT> pat(query.data(), query.size());
+
+    if (pat.blocks() != 1) {
+        for (; first != last; ++first, ++out) {
+            *out = levenshtein(pat, first->data(), first->size(), max);
+        }
+        return out;
+    }
+
+    static const CharT padding[1] = {};
+    const word lastBit = pat.last_bit();
+    while (first != last) {
+        const CharT* t[lanes];
+        size_t len[lanes];
+        size_t used = 0, longest = 0;
+        for (; used < lanes && first != last; ++used, ++first) {
+            len[used] = first->size();
+            t[used] = len[used] ? first->data() : padding;
+            longest = std::max(longest, len[used]);
+        }
+        for (size_t l = used; l < lanes; l++) {
+            t[l] = padding;
+            len[l] = 0;
+        }
+
+        word vp[lanes], vn[lanes], score[lanes];
+        for (size_t l = 0; l < lanes; l++) {
+            vp[l] = ~word(0);
+            vn[l] = 0;
+            score[l] = pat.size();
+        }
+        for (size_t j = 0; j < longest; j++) {
+            word eq[lanes], active[lanes];
+            for (size_t l = 0; l < lanes; l++) {
+                active[l] = word(0) - (j < len[l]);
+                eq[l] = pat.eq(0, t[l][j < len[l] ? j : 0]) & active[l];
+            }
+            for (size_t l = 0; l < lanes; l++) {
+                const word xv = eq[l] | vn[l];
+                const word xh = (((eq[l] & vp[l]) + vp[l]) ^ vp[l]) | eq[l];
+                word hp = vn[l] | ~(xh | vp[l]);
+                word hn = vp[l] & xh;
+                score[l] += ((hp & lastBit) != 0) & active[l];
+                score[l] -= ((hn & lastBit) != 0) & active[l];
+                hp = (hp << 1) | 1;
+                hn <<= 1;
+                vp[l] = ((hn | ~(xv | hp)) & active[l]) | (vp[l] & ~active[l]);
+                vn[l] = ((hp & xv) & active[l]) | (vn[l] & ~active[l]);
+            }
+        }
+
+        for (size_t l = 0; l < used; l++, ++out) {
+            const size_t d = pat.size() == 0 ? len[l] : static_cast<size_t>(score[l]);
+            *out = d <= max ? d : max + 1;
+        }
+    }
+    return out;
+}
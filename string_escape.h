@@ -0,0 +1,318 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include "string.h"
+
+// Escaping and encoding appenders. Every function measures its output
+// first and then writes straight into dst's spare capacity through
+// resize_and_overwrite, so dst grows at most once per call and nothing
+// goes through push_back or operator+=.
+//
+// The JSON escaper looks at eight bytes at a time: a word without a quote,
+// backslash or control character is copied as is, and only words holding
+// one of those are looked at byte by byte. CSV quoting leans on memchr,
+// which the C library already vectorizes.
+//
+// Decoders return false on malformed input and leave dst untouched.
+
+namespace string_escape {
+
+    constexpr uint64_t ones = 0x0101010101010101ull;
+    constexpr uint64_t highs = 0x8080808080808080ull;
+
+    inline uint64_t load(const char* p) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        return w;
+    }
+
+    // Nonzero if some byte of w is zero
+    inline uint64_t has_zero(uint64_t w) {
+        return (w - ones) & ~w & highs;
+    }
+
+    // Nonzero if w holds a byte JSON has to escape
+    inline uint64_t has_json_special(uint64_t w) {
+        const uint64_t control = (w - ones * 0x20) & ~w & highs;
+        return control | has_zero(w ^ (ones * '"')) | has_zero(w ^ (ones * '\\'));
+    }
+
+    inline bool is_json_special(unsigned char c) {
+        return c < 0x20 || c == '"' || c == '\\';
+    }
+
+    // Length of the escape sequence for a special character
+    inline size_t json_escape_size(unsigned char c) {
+        switch (c) {
+        case '"': case '\\': case '\b': case '\f': case '\n': case '\r': case '\t':
+            return 2;
+        default:
+            return 6; // \u00XX
+        }
+    }
+
+    inline char* json_escape(char* out, unsigned char c) {
+        static const char hex[] = "0123456789abcdef";
+        *out++ = '\\';
+        switch (c) {
+        case '"': *out++ = '"'; break;
+        case '\\': *out++ = '\\'; break;
+        case '\b': *out++ = 'b'; break;
+        case '\f': *out++ = 'f'; break;
+        case '\n': *out++ = 'n'; break;
+        case '\r': *out++ = 'r'; break;
+        case '\t': *out++ = 't'; break;
+        default:
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = hex[c >> 4];
+            *out++ = hex[c & 0xf];
+        }
+        return out;
+    }
+
+    // Calls onRun(pos, len) for every run without special characters and
+    // onSpecial(c) for every special character, in order.
+    template<typename OnRun, typename OnSpecial>
+    void for_each_json_run(const char* s, size_t len, OnRun onRun, OnSpecial onSpecial) {
+        size_t run = 0, i = 0;
+        while (i < len) {
+            if (i + 8 <= len && !has_json_special(load(s + i))) {
+                i += 8;
+                continue;
+            }
+            const size_t end = std::min(i + 8, len);
+            for (; i < end; i++) {
+                const unsigned char c = static_cast<unsigned char>(s[i]);
+                if (is_json_special(c)) {
+                    if (i > run) onRun(run, i - run);
+                    onSpecial(c);
+                    run = i + 1;
+                }
+            }
+        }
+        if (len > run) onRun(run, len - run);
+    }
+
+    inline const char* hex_digits(bool upper) {
+        return upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    }
+
+    // Value of a hex digit, or -1
+    inline int hex_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    constexpr char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // Six bit value of every character, 0xff for characters outside the alphabet
+    struct base64_table {
+        unsigned char value[256];
+
+        constexpr base64_table() : value() {
+            for (int i = 0; i < 256; i++) value[i] = 0xff;
+            for (int i = 0; i < 64; i++) value[static_cast<unsigned char>(base64_alphabet[i])] = static_cast<unsigned char>(i);
+        }
+    };
+
+    constexpr base64_table base64_values{};
+
+}
+
+// Appends s with JSON string escaping (without the surrounding quotes).
+// Bytes from 0x80 up are copied unchanged, so UTF-8 passes through.
+template<typename Allocator>
+stringT<char, Allocator>& append_json_escaped(stringT<char, Allocator>& dst, const char* s, size_t len) {
+    using namespace string_escape;
+    size_t size = len;
+    for_each_json_run(s, len, [](size_t, size_t) {}, [&](unsigned char c) { size += json_escape_size(c) - 1; });
+
+    dst.resize_and_overwrite(dst.size() + size, [&](char* p, size_t count) {
+        char* out = p + count - size;
+        if (size == len) {
+            memcpy(out, s, len);
+            return count;
+        }
+        for_each_json_run(s, len,
+            [&](size_t pos, size_t n) { memcpy(out, s + pos, n); out += n; },
+            [&](unsigned char c) { out = json_escape(out, c); });
+        return count;
+    });
+    return dst;
+}
+
+template<typename Allocator>
+stringT<char, Allocator>& append_json_escaped(stringT<char, Allocator>& dst, const stringT<char, Allocator>& s) {
+    return append_json_escaped(dst, s.data(), s.size());
+}
+
+// Appends s as a quoted CSV field (RFC 4180): wrapped in quotes, with
+// embedded quotes doubled. Delimiters and line breaks need nothing else
+// inside quotes.
+template<typename Allocator>
+stringT<char, Allocator>& append_csv_quoted(stringT<char, Allocator>& dst, const char* s, size_t len) {
+    size_t quotes = 0;
+    for (const char* q = len ? static_cast<const char*>(memchr(s, '"', len)) : nullptr; q;
+        q = static_cast<const char*>(memchr(q + 1, '"', s + len - q - 1))) {
+        quotes++;
+    }
+
+    const size_t size = len + quotes + 2;
+    dst.resize_and_overwrite(dst.size() + size, [&](char* p, size_t count) {
+        char* out = p + count - size;
+        *out++ = '"';
+        const char* in = s;
+        const char* end = s + len;
+        for (size_t i = 0; i < quotes; i++) {
+            const char* q = static_cast<const char*>(memchr(in, '"', end - in));
+            memcpy(out, in, q - in + 1);
+            out += q - in + 1;
+            *out++ = '"';
+            in = q + 1;
+        }
+        memcpy(out, in, end - in);
+        out[end - in] = '"';
+        return count;
+    });
+    return dst;
+}
+
+template<typename Allocator>
+stringT<char, Allocator>& append_csv_quoted(stringT<char, Allocator>& dst, const stringT<char, Allocator>& s) {
+    return append_csv_quoted(dst, s.data(), s.size());
+}
+
+// Appends two hex digits per byte of s
+template<typename Allocator>
+stringT<char, Allocator>& append_hex(stringT<char, Allocator>& dst, const char* s, size_t len, bool upper = false) {
+    const char* digits = string_escape::hex_digits(upper);
+    dst.resize_and_overwrite(dst.size() + 2 * len, [&](char* p, size_t count) {
+        char* out = p + count - 2 * len;
+        for (size_t i = 0; i < len; i++) {
+            const unsigned char c = static_cast<unsigned char>(s[i]);
+            out[2 * i] = digits[c >> 4];
+            out[2 * i + 1] = digits[c & 0xf];
+        }
+        return count;
+    });
+    return dst;
+}
+
+template<typename Allocator>
+stringT<char, Allocator>& append_hex(stringT<char, Allocator>& dst, const stringT<char, Allocator>& s, bool upper = false) {
+    return append_hex(dst, s.data(), s.size(), upper);
+}
+
+// Appends the bytes encoded by the hex digits in s, either case.
+template<typename Allocator>
+bool append_hex_decoded(stringT<char, Allocator>& dst, const char* s, size_t len) {
+    if (len % 2) {
+        return false;
+    }
+    int bad = 0;
+    for (size_t i = 0; i < len; i++) {
+        bad |= string_escape::hex_value(s[i]);
+    }
+    if (bad < 0) {
+        return false;
+    }
+
+    dst.resize_and_overwrite(dst.size() + len / 2, [&](char* p, size_t count) {
+        char* out = p + count - len / 2;
+        for (size_t i = 0; i < len / 2; i++) {
+            out[i] = static_cast<char>((string_escape::hex_value(s[2 * i]) << 4) | string_escape::hex_value(s[2 * i + 1]));
+        }
+        return count;
+    });
+    return true;
+}
+
+template<typename Allocator>
+bool append_hex_decoded(stringT<char, Allocator>& dst, const stringT<char, Allocator>& s) {
+    return append_hex_decoded(dst, s.data(), s.size());
+}
+
+// Appends s in standard base64 with '=' padding
+template<typename Allocator>
+stringT<char, Allocator>& append_base64(stringT<char, Allocator>& dst, const char* s, size_t len) {
+    using string_escape::base64_alphabet;
+    const size_t size = (len + 2) / 3 * 4;
+    dst.resize_and_overwrite(dst.size() + size, [&](char* p, size_t count) {
+        char* out = p + count - size;
+        const unsigned char* in = reinterpret_cast<const unsigned char*>(s);
+        size_t i = 0;
+        for (; i + 3 <= len; i += 3) {
+            const uint32_t v = (uint32_t(in[i]) << 16) | (uint32_t(in[i + 1]) << 8) | in[i + 2];
+            *out++ = base64_alphabet[v >> 18];
+            *out++ = base64_alphabet[(v >> 12) & 0x3f];
+            *out++ = base64_alphabet[(v >> 6) & 0x3f];
+            *out++ = base64_alphabet[v & 0x3f];
+        }
+        if (i < len) {
+            const uint32_t v = (uint32_t(in[i]) << 16) | (i + 1 < len ? uint32_t(in[i + 1]) << 8 : 0);
+            *out++ = base64_alphabet[v >> 18];
+            *out++ = base64_alphabet[(v >> 12) & 0x3f];
+            *out++ = i + 1 < len ? base64_alphabet[(v >> 6) & 0x3f] : '=';
+            *out++ = '=';
+        }
+        return count;
+    });
+    return dst;
+}
+
+template<typename Allocator>
+stringT<char, Allocator>& append_base64(stringT<char, Allocator>& dst, const stringT<char, Allocator>& s) {
+    return append_base64(dst, s.data(), s.size());
+}
+
+// Appends the bytes encoded by base64 text s. The length must be a
+// multiple of four, with at most two '=' at the end.
+template<typename Allocator>
+bool append_base64_decoded(stringT<char, Allocator>& dst, const char* s, size_t len) {
+    const unsigned char* values = string_escape::base64_values.value;
+    if (len % 4) {
+        return false;
+    }
+    size_t pad = 0;
+    if (len >= 4) {
+        pad = (s[len - 1] == '=') + (s[len - 2] == '=' && s[len - 1] == '=');
+    }
+
+    // Every character outside the alphabet maps to 0xff
+    unsigned char bad = 0;
+    for (size_t i = 0; i < len - pad; i++) {
+        bad |= values[static_cast<unsigned char>(s[i])];
+    }
+    if (bad & 0xc0) {
+        return false;
+    }
+
+    const size_t size = len / 4 * 3 - pad;
+    dst.resize_and_overwrite(dst.size() + size, [&](char* p, size_t count) {
+        char* out = p + count - size;
+        const size_t full = pad ? len - 4 : len;
+        auto value = [&](size_t i) { return uint32_t(values[static_cast<unsigned char>(s[i])]); };
+        for (size_t i = 0; i < full; i += 4) {
+            const uint32_t v = (value(i) << 18) | (value(i + 1) << 12) | (value(i + 2) << 6) | value(i + 3);
+            *out++ = static_cast<char>(v >> 16);
+            *out++ = static_cast<char>(v >> 8);
+            *out++ = static_cast<char>(v);
+        }
+        if (pad) {
+            const uint32_t v = (value(full) << 18) | (value(full + 1) << 12) | (pad == 1 ? value(full + 2) << 6 : 0);
+            *out++ = static_cast<char>(v >> 16);
+            if (pad == 1) *out++ = static_cast<char>(v >> 8);
+        }
+        return count;
+    });
+    return true;
+}
+
+template<typename Allocator>
+bool append_base64_decoded(stringT<char, Allocator>& dst, const stringT<char, Allocator>& s) {
+    return append_base64_decoded(dst, s.data(), s.size());
+}
@@ -0,0 +1,365 @@
+#pragma once
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <vector>
+#include "string.h"
+
+// Shell style wildcard matching: '*' matches any run of characters, '?'
+// any single character, "[abc]", "[a-z]" and "[!a-z]" (or "[^a-z]") a
+// character class, and '\' makes the next character literal. An
+// unterminated '[' is an ordinary character.
+//
+// glob_pattern compiles a pattern once into the segments between its
+// stars. A match never backtracks across a star: the first and last
+// segments are pinned to the ends of the subject, and every segment in
+// between is taken at its leftmost position, which can never rule out a
+// match later on. Each segment is located by running stringT's find on
+// its longest literal run and checking the rest of the segment around
+// each hit.
+//
+// glob_set holds many patterns. Every pattern's longest literal run must
+// appear in any string it matches, so one Aho-Corasick pass over the
+// subject finds all runs present and only those patterns are checked in
+// full.
+
+class glob_pattern {
+public:
+    typedef size_t size_type;
+    static constexpr size_type npos = size_type(-1);
+
+    glob_pattern(const char* pattern, size_type len) {
+        _compile(pattern, len);
+    }
+
+    glob_pattern(const char* pattern) : glob_pattern(pattern, strlen(pattern)) {}
+
+    template<typename Allocator>
+    glob_pattern(const stringT<char, Allocator>& pattern) : glob_pattern(pattern.data(), pattern.size()) {}
+
+    bool match(const char* s, size_type n) const {
+        if (!m_star) {
+            return m_segments.empty() ? n == 0 : (m_segments[0].len == n && _verify(m_segments[0], s, 0));
+        }
+
+        size_type pos = 0, end = n;
+        size_type first = 0, last = m_segments.size();
+        if (m_anchoredStart && first < last) {
+            const segment& seg = m_segments[first++];
+            if (seg.len > n || !_verify(seg, s, 0)) return false;
+            pos = seg.len;
+        }
+        if (m_anchoredEnd && first < last) {
+            const segment& seg = m_segments[--last];
+            if (seg.len > n - pos || !_verify(seg, s, n - seg.len)) return false;
+            end = n - seg.len;
+        }
+        for (size_type i = first; i < last; i++) {
+            const size_type p = _search(m_segments[i], s, pos, end);
+            if (p == npos) return false;
+            pos = p + m_segments[i].len;
+        }
+        return true;
+    }
+
+    template<typename Allocator>
+    bool match(const stringT<char, Allocator>& s) const {
+        return match(s.data(), s.size());
+    }
+
+    // Longest run of literal characters; every match contains it
+    const string& required_literal() const noexcept {
+        return m_required;
+    }
+
+private:
+    enum unit_kind : unsigned char { literal, any, set };
+
+    struct unit {
+        unit_kind kind;
+        char c;
+        uint32_t set;
+    };
+
+    struct segment {
+        // units [begin, begin + len)
+        size_type begin;
+        size_type len;
+        // Longest literal run of the segment: offset and characters
+        size_type anchor;
+        string run;
+    };
+
+    std::vector<unit> m_units;
+    std::vector<std::bitset<256>> m_sets;
+    std::vector<segment> m_segments;
+    string m_required;
+    bool m_star = false;
+    bool m_anchoredStart = true;
+    bool m_anchoredEnd = true;
+
+    void _compile(const char* p, size_type len) {
+        size_type segBegin = 0;
+        for (size_type i = 0; i < len; i++) {
+            const char c = p[i];
+            if (c == '*') {
+                m_star = true;
+                if (i == 0) m_anchoredStart = false;
+                if (i + 1 == len) m_anchoredEnd = false;
+                _close_segment(segBegin);
+                segBegin = m_units.size();
+            }
+            else if (c == '?') {
+                m_units.push_back({ any, 0, 0 });
+            }
+            else if (c == '[' && _parse_set(p, len, i)) {
+                // i now points at the closing ']'
+            }
+            else if (c == '\\' && i + 1 < len) {
+                m_units.push_back({ literal, p[++i], 0 });
+            }
+            else {
+                m_units.push_back({ literal, c, 0 });
+            }
+        }
+        _close_segment(segBegin);
+
+        for (const segment& seg : m_segments) {
+            if (seg.run.size() > m_required.size()) m_required = seg.run;
+        }
+    }
+
+    // Parses the class starting at p[i] == '['. On success adds it and
+    // leaves i on the closing ']'.
+    bool _parse_set(const char* p, size_type len, size_type& i) {
+        size_type j = i + 1;
+        const bool negate = j < len && (p[j] == '!' || p[j] == '^');
+        if (negate) j++;
+
+        std::bitset<256> bits;
+        bool first = true;
+        for (; j < len && (first || p[j] != ']'); j++, first = false) {
+            unsigned char lo = static_cast<unsigned char>(p[j]);
+            if (p[j] == '\\' && j + 1 < len) lo = static_cast<unsigned char>(p[++j]);
+            unsigned char hi = lo;
+            if (j + 2 < len && p[j + 1] == '-' && p[j + 2] != ']') {
+                j += 2;
+                hi = static_cast<unsigned char>(p[j]);
+                if (p[j] == '\\' && j + 1 < len) hi = static_cast<unsigned char>(p[++j]);
+            }
+            for (unsigned c = lo; c <= hi; c++) bits.set(c);
+        }
+        if (j >= len) {
+            return false;
+        }
+
+        if (negate) bits.flip();
+        m_units.push_back({ set, 0, static_cast<uint32_t>(m_sets.size()) });
+        m_sets.push_back(bits);
+        i = j;
+        return true;
+    }
+
+    void _close_segment(size_type begin) {
+        const size_type len = m_units.size() - begin;
+        if (len == 0) return;
+
+        segment seg = { begin, len, 0, string() };
+        size_type best = 0;
+        for (size_type i = 0; i < len;) {
+            size_type j = i;
+            while (j < len && m_units[begin + j].kind == literal) j++;
+            if (j - i > best) {
+                best = j - i;
+                seg.anchor = i;
+            }
+            i = j + 1;
+        }
+        if (best > 0) {
+            seg.run.resize_and_overwrite(best, [&](char* out, size_type count) {
+                for (size_type k = 0; k < count; k++) out[k] = m_units[begin + seg.anchor + k].c;
+                return count;
+            });
+        }
+        m_segments.push_back(std::move(seg));
+    }
+
+    bool _verify(const segment& seg, const char* s, size_type p) const {
+        for (size_type k = 0; k < seg.len; k++) {
+            const unit& u = m_units[seg.begin + k];
+            const char c = s[p + k];
+            if (u.kind == literal ? u.c != c : (u.kind == set && !m_sets[u.set][static_cast<unsigned char>(c)])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Leftmost p in [pos, end - seg.len] where seg matches
+    size_type _search(const segment& seg, const char* s, size_type pos, size_type end) const {
+        if (seg.len > end - pos) return npos;
+        if (seg.run.empty()) {
+            for (size_type p = pos; p + seg.len <= end; p++) {
+                if (_verify(seg, s, p)) return p;
+            }
+            return npos;
+        }
+
+        // Hits of the run that leave room for the rest of the segment
+        const size_type runLen = seg.run.size();
+        const size_type hayLen = end - (seg.len - seg.anchor - runLen);
+        for (size_type hit = string::find_in(s, hayLen, seg.run.data(), pos + seg.anchor, runLen); hit != string::npos;
+            hit = string::find_in(s, hayLen, seg.run.data(), hit + 1, runLen)) {
+            if (_verify(seg, s, hit - seg.anchor)) return hit - seg.anchor;
+        }
+        return npos;
+    }
+};
+
+class glob_set {
+public:
+    typedef size_t size_type;
+
+    // Adds a pattern and returns its index. Call build() before matching.
+    template<typename... Args>
+    size_type add(Args&&... pattern) {
+        m_patterns.emplace_back(std::forward<Args>(pattern)...);
+        m_built = false;
+        return m_patterns.size() - 1;
+    }
+
+    size_type size() const noexcept {
+        return m_patterns.size();
+    }
+
+    const glob_pattern& operator[](size_type i) const {
+        return m_patterns[i];
+    }
+
+    // Builds the automaton over the patterns' required literals
+    void build() {
+        m_nodes.assign(1, node());
+        m_outputs.clear();
+        m_unfiltered.clear();
+
+        for (size_type i = 0; i < m_patterns.size(); i++) {
+            const string& lit = m_patterns[i].required_literal();
+            if (lit.empty()) {
+                m_unfiltered.push_back(i);
+                continue;
+            }
+            uint32_t n = 0;
+            for (size_type k = 0; k < lit.size(); k++) {
+                uint32_t next = _child(n, lit[k]);
+                if (next == 0) {
+                    next = static_cast<uint32_t>(m_nodes.size());
+                    m_nodes[n].next.insert(std::upper_bound(m_nodes[n].next.begin(), m_nodes[n].next.end(),
+                        edge{ static_cast<unsigned char>(lit[k]), 0 }), edge{ static_cast<unsigned char>(lit[k]), next });
+                    m_nodes.emplace_back();
+                }
+                n = next;
+            }
+            m_outputs.push_back({ static_cast<uint32_t>(i), m_nodes[n].output });
+            m_nodes[n].output = static_cast<uint32_t>(m_outputs.size());
+        }
+
+        // Failure and output links, breadth first
+        std::fill(m_root, m_root + 256, 0u);
+        std::vector<uint32_t> queue;
+        for (const edge& e : m_nodes[0].next) {
+            m_root[e.c] = e.node;
+            queue.push_back(e.node);
+        }
+        for (size_type q = 0; q < queue.size(); q++) {
+            const uint32_t n = queue[q];
+            m_nodes[n].report = m_nodes[n].output ? n : m_nodes[m_nodes[n].fail].report;
+            for (const edge& e : m_nodes[n].next) {
+                m_nodes[e.node].fail = _step(m_nodes[n].fail, static_cast<char>(e.c));
+                queue.push_back(e.node);
+            }
+        }
+        m_built = true;
+    }
+
+    // Indices of all patterns matching s, in increasing order
+    template<typename Allocator>
+    void match_all(const stringT<char, Allocator>& s, std::vector<size_type>& out) const {
+        out.clear();
+        _candidates(s.data(), s.size(), out);
+        out.erase(std::remove_if(out.begin(), out.end(),
+            [&](size_type i) { return !m_patterns[i].match(s.data(), s.size()); }), out.end());
+        std::sort(out.begin(), out.end());
+    }
+
+    template<typename Allocator>
+    bool match_any(const stringT<char, Allocator>& s) const {
+        std::vector<size_type> candidates;
+        _candidates(s.data(), s.size(), candidates);
+        for (size_type i : candidates) {
+            if (m_patterns[i].match(s.data(), s.size())) return true;
+        }
+        return false;
+    }
+
+private:
+    struct edge {
+        unsigned char c;
+        uint32_t node;
+
+        bool operator<(const edge& rhs) const { return c < rhs.c; }
+    };
+
+    struct node {
+        std::vector<edge> next;
+        uint32_t fail = 0;
+        // Head of this node's list in m_outputs, 1 based; 0 if none
+        uint32_t output = 0;
+        // Nearest node on the failure chain with an output, this one included
+        uint32_t report = 0;
+    };
+
+    std::vector<glob_pattern> m_patterns;
+    std::vector<node> m_nodes;
+    // (pattern, next entry) lists of patterns per literal
+    std::vector<std::pair<uint32_t, uint32_t>> m_outputs;
+    // Patterns without any literal character, always checked in full
+    std::vector<size_type> m_unfiltered;
+    uint32_t m_root[256] = {};
+    bool m_built = false;
+
+    uint32_t _child(uint32_t n, char c) const {
+        const auto& next = m_nodes[n].next;
+        auto it = std::lower_bound(next.begin(), next.end(), edge{ static_cast<unsigned char>(c), 0 });
+        return (it != next.end() && it->c == static_cast<unsigned char>(c)) ? it->node : 0;
+    }
+
+    uint32_t _step(uint32_t n, char c) const {
+        while (n != 0) {
+            if (uint32_t next = _child(n, c)) return next;
+            n = m_nodes[n].fail;
+        }
+        return m_root[static_cast<unsigned char>(c)];
+    }
+
+    // Patterns whose required literal occurs in s, plus the unfiltered ones
+    void _candidates(const char* s, size_type n, std::vector<size_type>& out) const {
+        assert(m_built);
+        std::vector<uint32_t> reported;
+        uint32_t state = 0;
+        for (size_type i = 0; i < n; i++) {
+            state = _step(state, s[i]);
+            for (uint32_t r = m_nodes[state].report; r != 0; r = m_nodes[m_nodes[r].fail].report) {
+                reported.push_back(r);
+            }
+        }
+        std::sort(reported.begin(), reported.end());
+        reported.erase(std::unique(reported.begin(), reported.end()), reported.end());
+
+        out.insert(out.end(), m_unfiltered.begin(), m_unfiltered.end());
+        for (uint32_t r : reported) {
+            for (uint32_t o = m_nodes[r].output; o != 0; o = m_outputs[o - 1].second) {
+                out.push_back(m_outputs[o - 1].first);
+            }
+        }
+    }
+};
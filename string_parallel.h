@@ -0,0 +1,448 @@
+#pragma once
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <vector>
+#include "string.h"
+
+// Multi-threaded find/count/replace for very large strings.
+//
+// The string is split into one chunk per thread. Matches are
+// non-overlapping and taken left to right, exactly like a loop over
+// stringT::find, and a match belongs to the chunk it starts in even when
+// it runs up to count - 1 characters into the next one. The sequential
+// scan therefore enters a chunk at one of count entry offsets: at its
+// start, or where the previous chunk's last match ended.
+//
+// Work is done in two parallel passes with an O(chunks) join in between:
+//  1. Every chunk counts its matches, and where its last match ends, for
+//     each entry offset. The scans for all offsets are advanced together
+//     in position order and merge as soon as two reach the same match, so
+//     every match is visited at most once. A run of overlapping matches,
+//     such as a long needle in a uniform region, is measured once and
+//     every scan crosses it in one jump, so the pass stays linear in the
+//     chunk size whatever the needle.
+//  2. The join picks every chunk's real entry offset from the previous
+//     chunk's exit. With the counts known, every chunk rescans from its
+//     entry and writes its part of the result at a prefix-summed offset.
+// No match positions are kept between the passes.
+//
+// Strings shorter than a couple of chunks are searched on the calling
+// thread without starting any threads.
+
+namespace string_parallel {
+
+    // Smallest amount of characters worth giving to a thread.
+    constexpr size_t min_chunk = size_t(1) << 18;
+
+    // Result of scanning a chunk from one entry position
+    struct entry {
+        size_t count = 0;
+        // First position a match following this chunk may start at
+        size_t next = 0;
+    };
+
+    struct chunk {
+        size_t begin = 0;
+        size_t end = 0;
+        // entries[e]: the scan entering at begin + e
+        std::vector<entry> entries;
+        // Set by the join: where the sequential scan enters, and its result
+        size_t start = 0;
+        entry result;
+    };
+
+    // Runs fn(0) .. fn(n - 1), fn(0) on the calling thread.
+    template<typename Fn>
+    void run(size_t n, Fn fn) {
+        std::vector<std::thread> workers;
+        workers.reserve(n ? n - 1 : 0);
+        for (size_t i = 1; i < n; i++) {
+            workers.emplace_back(fn, i);
+        }
+        if (n > 0) fn(0);
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    inline size_t chunk_count(size_t size, size_t needle, size_t threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        const size_t perChunk = std::max(min_chunk, needle);
+        return std::max<size_t>(1, std::min(threads, size / perChunk));
+    }
+
+    // First match at or after a position that starts before end, or npos
+    template<typename S>
+    class finder {
+    public:
+        typedef typename S::size_type size_type;
+
+        finder(const S& str, const S& needle, size_type end)
+            : m_str(str), m_needle(needle), m_end(end), m_limit(std::min(str.size(), end + needle.size() - 1)) {}
+
+        size_type operator()(size_type from) const {
+            const size_type p = S::find_in(m_str.data(), m_limit, m_needle.data(), from, m_needle.size());
+            return p < m_end ? p : S::npos;
+        }
+
+    private:
+        const S& m_str;
+        const S& m_needle;
+        size_type m_end;
+        size_type m_limit;
+    };
+
+    // Greedy scan entering at from, whose first match is first. Calls
+    // onHit for every match.
+    template<typename S, typename OnHit>
+    entry scan(const finder<S>& find, size_t from, size_t first, size_t m, OnHit onHit) {
+        entry e;
+        e.next = from;
+        for (size_t p = first; p != S::npos; p = find(p + m)) {
+            onHit(p);
+            e.count++;
+            e.next = p + m;
+        }
+        return e;
+    }
+
+    // Smallest period of needle, from its longest proper border
+    template<typename S>
+    size_t period(const S& needle) {
+        const size_t m = needle.size();
+        std::vector<size_t> border(m + 1, 0);
+        for (size_t i = 1, k = 0; i < m; i++) {
+            while (k > 0 && needle.data()[i] != needle.data()[k]) k = border[k];
+            if (needle.data()[i] == needle.data()[k]) k++;
+            border[i + 1] = k;
+        }
+        return m - border[m];
+    }
+
+    // Like finder, but for rising positions only: every call's from must
+    // be at least the previous one's. Matches are found as runs: after a
+    // match at p the next one can be no closer than p + period, and it is
+    // there exactly if the period characters past the match continue the
+    // needle. So a run of matches a period apart lasts as long as the text
+    // repeats itself with that period, and no other match starts inside it.
+    template<typename S>
+    class cursor {
+    public:
+        cursor(const S& str, const S& needle, size_t period, size_t end)
+            : m_find(str, needle, end), m_str(str.data()), m_size(needle.size()),
+            m_period(period), m_end(end), m_limit(std::min(str.size(), end + needle.size() - 1)) {}
+
+        size_t operator()(size_t from) {
+            assert(from >= m_from);
+            m_from = from;
+            if (!m_known || (m_last != S::npos && from > m_last)) {
+                _start(m_find(from));
+            }
+            if (m_first == S::npos || from <= m_first) {
+                return m_first;
+            }
+            return m_first + (from - m_first + m_period - 1) / m_period * m_period;
+        }
+
+        // Last match of the run holding the last match returned
+        size_t run_last() const noexcept {
+            return m_last;
+        }
+
+    private:
+        finder<S> m_find;
+        const typename S::value_type* m_str;
+        size_t m_size;
+        size_t m_period;
+        size_t m_end;
+        size_t m_limit;
+        size_t m_from = 0;
+        bool m_known = false;
+        // The current run: matches m_first, m_first + period, .. m_last
+        size_t m_first = 0;
+        size_t m_last = 0;
+
+        void _start(size_t p) {
+            m_known = true;
+            m_first = m_last = p;
+            if (p == S::npos) {
+                return;
+            }
+            // The run lasts while every character past the match repeats
+            // the one a period before it. Compare in growing blocks so a
+            // long uniform region goes at memcmp speed.
+            size_t x = p + m_size;
+            for (size_t block = 16; x < m_limit; block = std::min<size_t>(2 * block, 4096)) {
+                const size_t n = std::min(block, m_limit - x);
+                if (memcmp(m_str + x, m_str + x - m_period, n * sizeof(*m_str)) != 0) {
+                    while (m_str[x] == m_str[x - m_period]) x++;
+                    break;
+                }
+                x += n;
+            }
+            const size_t runs = std::min((x - p - m_size) / m_period, (m_end - 1 - p) / m_period);
+            m_last = p + runs * m_period;
+        }
+    };
+
+    // Pass 1 for one chunk. Entry offsets whose first match is the same
+    // share one scan (a walk). The walks are kept ordered by their next
+    // match, all different: the front one is advanced, and as its next
+    // match can't come before any other walk's, it goes to the back or
+    // merges into the back walk if both reached the same match. Every
+    // match is visited at most once.
+    //
+    // Inside a run of matches a period apart, a walk steps by the needle
+    // length rounded up to whole periods, and walks entering the run out
+    // of step stay out of step until it ends. So when the front walk is
+    // in such a run, every walk in it jumps to its last match in the run
+    // at once, and only the exits are searched.
+    template<typename S>
+    void survey(const S& str, const S& needle, size_t period, chunk& c, bool first) {
+        const size_t m = needle.size();
+        const size_t step = (m + period - 1) / period * period;
+        cursor<S> next(str, needle, period, c.end);
+        c.entries.assign(first ? 1 : m, entry());
+
+        struct walk {
+            // Next match, not counted yet, and the last match of its run
+            size_t pos;
+            size_t run;
+            // Matches before pos and where the last one ends; once the walk
+            // has stopped, the chunk's result for it
+            entry r;
+            // Walk this one merged into, with both walks' counts at the merge
+            size_t into = S::npos;
+            size_t count = 0;
+            size_t intoCount = 0;
+        };
+        std::vector<walk> walks;
+
+        // source[e]: the walk of entry offset e, npos if it has no match
+        std::vector<size_t> source(c.entries.size());
+        for (size_t e = 0; e < c.entries.size(); e++) {
+            const size_t p = next(c.begin + e);
+            if (p == S::npos) {
+                c.entries[e].next = c.begin + e;
+                source[e] = S::npos;
+                continue;
+            }
+            if (walks.empty() || walks.back().pos != p) {
+                walks.push_back(walk{ p, next.run_last(), entry() });
+            }
+            source[e] = walks.size() - 1;
+        }
+
+        std::deque<size_t> queue;
+        for (size_t i = 0; i < walks.size(); i++) {
+            queue.push_back(i);
+        }
+        // Walks in the order they stopped
+        std::vector<size_t> stopped;
+        // Moves walk i to match p, just returned by next, and queues it at
+        // the back of q, merging it into the back walk on the same match
+        auto requeue = [&](std::deque<size_t>& q, size_t i, size_t p) {
+            walk& w = walks[i];
+            w.pos = p;
+            w.run = next.run_last();
+            if (w.pos != S::npos && !q.empty() && walks[q.back()].pos == w.pos) {
+                w.into = q.back();
+                w.count = w.r.count;
+                w.intoCount = walks[w.into].r.count;
+            }
+            if (w.pos == S::npos || w.into != S::npos) {
+                stopped.push_back(i);
+            }
+            else {
+                q.push_back(i);
+            }
+        };
+
+        std::vector<std::pair<size_t, size_t>> exits;
+        while (!queue.empty()) {
+            walk& front = walks[queue.front()];
+            const size_t run = front.run;
+            if (front.pos + step > run) {
+                const size_t i = queue.front();
+                queue.pop_front();
+                front.r.count++;
+                front.r.next = front.pos + m;
+                requeue(queue, i, next(front.pos + m));
+                continue;
+            }
+
+            // Every walk in the run takes its last match there; the exits
+            // are searched in rising order and merged with the walks
+            // already past the run
+            exits.clear();
+            while (!queue.empty() && walks[queue.front()].pos <= run) {
+                walk& w = walks[queue.front()];
+                const size_t jumps = (run - w.pos) / step;
+                w.r.count += jumps + 1;
+                w.r.next = w.pos + jumps * step + m;
+                exits.emplace_back(w.r.next, queue.front());
+                queue.pop_front();
+            }
+            std::sort(exits.begin(), exits.end());
+            std::deque<size_t> merged;
+            for (const auto& x : exits) {
+                const size_t p = next(x.first);
+                while (!queue.empty() && walks[queue.front()].pos <= p) {
+                    merged.push_back(queue.front());
+                    queue.pop_front();
+                }
+                requeue(merged, x.second, p);
+            }
+            while (!queue.empty()) {
+                merged.push_back(queue.front());
+                queue.pop_front();
+            }
+            queue.swap(merged);
+        }
+
+        // A walk merged into one that stopped later
+        for (size_t k = stopped.size(); k-- > 0;) {
+            walk& w = walks[stopped[k]];
+            if (w.into != S::npos) {
+                const entry& into = walks[w.into].r;
+                w.r.count = w.count + into.count - w.intoCount;
+                w.r.next = into.next;
+            }
+        }
+        for (size_t e = 0; e < c.entries.size(); e++) {
+            if (source[e] != S::npos) {
+                c.entries[e] = walks[source[e]].r;
+            }
+        }
+    }
+
+    // Splits str, runs pass 1 and the join. Sets every chunk's start and
+    // result.
+    template<typename S>
+    std::vector<chunk> search(const S& str, const S& needle, size_t threads) {
+        const size_t n = chunk_count(str.size(), needle.size(), threads);
+        const size_t step = str.size() / n;
+
+        std::vector<chunk> chunks(n);
+        for (size_t i = 0; i < n; i++) {
+            chunks[i].begin = i * step;
+            chunks[i].end = (i + 1 == n) ? str.size() : (i + 1) * step;
+        }
+        const size_t p = period(needle);
+        run(n, [&](size_t i) { survey(str, needle, p, chunks[i], i == 0); });
+
+        size_t resume = 0;
+        for (chunk& c : chunks) {
+            const size_t e = resume > c.begin ? resume - c.begin : 0;
+            assert(e < c.entries.size());
+            c.start = c.begin + e;
+            c.result = c.entries[e];
+            resume = c.result.next;
+        }
+        return chunks;
+    }
+
+    // Pass 2: calls onHit for every match of the sequential scan in c
+    template<typename S, typename OnHit>
+    void rescan(const S& str, const S& needle, const chunk& c, OnHit onHit) {
+        const finder<S> find(str, needle, c.end);
+        scan<S>(find, c.start, find(c.start), needle.size(), onHit);
+    }
+
+}
+
+// Positions of all non-overlapping occurrences of needle, left to right.
+// threads == 0 uses one thread per hardware thread.
+template<typename CharT, typename Allocator>
+std::vector<typename stringT<CharT, Allocator>::size_type>
+parallel_find_all(const stringT<CharT, Allocator>& str, const stringT<CharT, Allocator>& needle, size_t threads = 0) {
+    typedef typename stringT<CharT, Allocator>::size_type size_type;
+    std::vector<size_type> result;
+    if (needle.empty() || needle.size() > str.size()) {
+        return result;
+    }
+
+    auto chunks = string_parallel::search(str, needle, threads);
+    std::vector<size_type> offset(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); i++) {
+        offset[i + 1] = offset[i] + chunks[i].result.count;
+    }
+    result.resize(offset.back());
+    string_parallel::run(chunks.size(), [&](size_t i) {
+        size_type* out = result.data() + offset[i];
+        string_parallel::rescan(str, needle, chunks[i], [&](size_type p) { *out++ = p; });
+    });
+    return result;
+}
+
+// Number of non-overlapping occurrences of needle.
+template<typename CharT, typename Allocator>
+typename stringT<CharT, Allocator>::size_type
+parallel_count(const stringT<CharT, Allocator>& str, const stringT<CharT, Allocator>& needle, size_t threads = 0) {
+    if (needle.empty() || needle.size() > str.size()) {
+        return 0;
+    }
+
+    typename stringT<CharT, Allocator>::size_type total = 0;
+    for (auto& c : string_parallel::search(str, needle, threads)) {
+        total += c.result.count;
+    }
+    return total;
+}
+
+// Replaces every non-overlapping occurrence of from with to. The output
+// offset of every chunk is a prefix sum over the chunk sizes, so the
+// result is allocated once and every thread writes its own part of it.
+template<typename CharT, typename Allocator>
+stringT<CharT, Allocator>& parallel_replace_all(stringT<CharT, Allocator>& str,
+    const stringT<CharT, Allocator>& from, const stringT<CharT, Allocator>& to, size_t threads = 0) {
+    typedef typename stringT<CharT, Allocator>::size_type size_type;
+    if (from.empty() || from.size() > str.size()) {
+        return str;
+    }
+
+    auto chunks = string_parallel::search(str, from, threads);
+    const size_type n = chunks.size();
+
+    // Chunk i copies the source range [src[i], src[i + 1]): it starts
+    // where the previous chunk's last match ended.
+    std::vector<size_type> src(n + 1), dst(n + 1);
+    for (size_type i = 0; i < n; i++) {
+        src[i] = chunks[i].start;
+    }
+    src[n] = str.size();
+
+    dst[0] = 0;
+    size_type hits = 0;
+    for (size_type i = 0; i < n; i++) {
+        const size_type count = chunks[i].result.count;
+        hits += count;
+        dst[i + 1] = dst[i] + (src[i + 1] - src[i]) - count * from.size() + count * to.size();
+    }
+    if (hits == 0) {
+        return str;
+    }
+
+    stringT<CharT, Allocator> result;
+    result.resize_and_overwrite(dst[n], [&](CharT* out, size_type total) {
+        string_parallel::run(n, [&](size_t i) {
+            const CharT* in = str.data();
+            size_type s = src[i];
+            CharT* d = out + dst[i];
+            string_parallel::rescan(str, from, chunks[i], [&](size_type p) {
+                memcpy(d, in + s, (p - s) * sizeof(CharT));
+                d += p - s;
+                memcpy(d, to.data(), to.size() * sizeof(CharT));
+                d += to.size();
+                s = p + from.size();
+            });
+            memcpy(d, in + s, (src[i + 1] - s) * sizeof(CharT));
+        });
+        return total;
+    });
+    str.swap(result);
+    return str;
+}